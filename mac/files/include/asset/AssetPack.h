@@ -0,0 +1,176 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __APPLE__
+#include <mach-o/dyld.h>
+#endif
+
+#include "memory/MemoryTracker.h"
+
+// Read-only bundle of game assets built offline by tools/pack_assets.
+//
+// Layout: a PackHeader, then PackHeader::count PackEntry records sorted by
+// name, then the file contents, each aligned to PACK_ALIGNMENT. The whole
+// file is mapped once and Get() hands out views straight into the mapping,
+// so nothing is copied until the consumer (GL, stb_image) reads it.
+
+const uint32_t PACK_MAGIC = 0x4b50474f; // "OGPK"
+const uint32_t PACK_VERSION = 1;
+const uint32_t PACK_ALIGNMENT = 16;
+const int PACK_NAME_LENGTH = 48;
+
+struct PackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct PackEntry {
+    uint64_t offset;
+    uint64_t size;
+    char name[PACK_NAME_LENGTH];
+};
+
+// contents of one asset; valid while the pack stays open
+struct AssetView {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+
+    bool valid() const {
+        return data != nullptr;
+    }
+    const char* text() const {
+        return (const char*)data;
+    }
+};
+
+class AssetPack {
+public:
+    AssetPack() {}
+
+    ~AssetPack() {
+        Close();
+    }
+
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    bool Open(const std::string& path) {
+        Close();
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cout << "ERROR::ASSET_PACK::NOT_FOUND " << path << std::endl;
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(PackHeader)) {
+            close(fd);
+            std::cout << "ERROR::ASSET_PACK::TRUNCATED " << path << std::endl;
+            return false;
+        }
+        void* mapped = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) {
+            std::cout << "ERROR::ASSET_PACK::MAP_FAILED " << path << std::endl;
+            return false;
+        }
+        base = (const unsigned char*)mapped;
+        length = st.st_size;
+        MemoryTracker::Get().Allocate(MEMORY_IO, length);
+
+        const PackHeader* header = (const PackHeader*)base;
+        if (header->magic != PACK_MAGIC || header->version != PACK_VERSION
+            || sizeof(PackHeader) + (size_t)header->count * sizeof(PackEntry) > length) {
+            std::cout << "ERROR::ASSET_PACK::BAD_HEADER " << path << std::endl;
+            Close();
+            return false;
+        }
+        entries = (const PackEntry*)(base + sizeof(PackHeader));
+        count = header->count;
+        // the whole pack is read during startup anyway
+        madvise((void*)base, length, MADV_WILLNEED);
+        return true;
+    }
+
+    void Close() {
+        if (base != nullptr) {
+            munmap((void*)base, length);
+            MemoryTracker::Get().Free(MEMORY_IO, length);
+        }
+        base = nullptr;
+        length = 0;
+        entries = nullptr;
+        count = 0;
+    }
+
+    // name is the path relative to the packed resources directory,
+    // e.g. "shaders/3d_lighting.vs"
+    AssetView Get(const std::string& name) const {
+        AssetView view;
+        size_t lo = 0, hi = count;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            int cmp = strncmp(entries[mid].name, name.c_str(), PACK_NAME_LENGTH);
+            if (cmp == 0) {
+                if (entries[mid].offset + entries[mid].size <= length) {
+                    view.data = base + entries[mid].offset;
+                    view.size = entries[mid].size;
+                }
+                return view;
+            }
+            if (cmp < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        std::cout << "ERROR::ASSET_PACK::MISSING " << name << std::endl;
+        return view;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    const PackEntry& entry(size_t i) const {
+        return entries[i];
+    }
+
+private:
+    const unsigned char* base = nullptr;
+    size_t length = 0;
+    const PackEntry* entries = nullptr;
+    size_t count = 0;
+};
+
+// directory containing the running binary, so assets and saves are found
+// no matter where the game is launched from
+inline std::string executableDirectory()
+{
+    char path[4096];
+    std::string exe;
+#ifdef __APPLE__
+    uint32_t size = sizeof(path);
+    if (_NSGetExecutablePath(path, &size) == 0)
+        exe = path;
+#else
+    ssize_t n = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (n > 0)
+        exe.assign(path, n);
+#endif
+    size_t slash = exe.find_last_of('/');
+    if (slash == std::string::npos)
+        return ".";
+    return exe.substr(0, slash);
+}
+
+#endif
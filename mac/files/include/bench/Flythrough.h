@@ -0,0 +1,334 @@
+#ifndef FLYTHROUGH_H
+#define FLYTHROUGH_H
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+
+#include "block/Block.h"
+#include "camera/Camera.h"
+#include "save/WorldSave.h"
+#include "render/RenderStats.h"
+#include "profile/FrameTiming.h"
+
+// hash of a grid point to [0, 1)
+inline float flythroughNoise(uint32_t seed, int x, int z)
+{
+    uint32_t h = seed ^ ((uint32_t)x * 0x8da6b343u) ^ ((uint32_t)z * 0xd8163841u);
+    h ^= h >> 13;
+    h *= 0x5bd1e995u;
+    h ^= h >> 15;
+    return (h & 0xffffff) / (float)0x1000000;
+}
+
+// Rolling terrain, size blocks across, that depends only on the seed: value
+// noise at two scales gives each column a height of 0 to 6, filled down to
+// y = -1. Low ground is water, high ground grey.
+inline void generateSeededWorld(uint32_t seed, int size, std::vector<Block>& blocks)
+{
+    int half = size / 2;
+    for (int z = -half; z < size - half; z++) {
+        for (int x = -half; x < size - half; x++) {
+            float height = 0.0f;
+            float amplitude = 4.0f;
+            for (int cell = 16; cell >= 4; cell /= 4) {
+                int cx = (int)std::floor((float)x / cell), cz = (int)std::floor((float)z / cell);
+                float fx = (float)x / cell - cx, fz = (float)z / cell - cz;
+                float a = flythroughNoise(seed, cx, cz), b = flythroughNoise(seed, cx + 1, cz);
+                float c = flythroughNoise(seed, cx, cz + 1), d = flythroughNoise(seed, cx + 1, cz + 1);
+                float top = a + (b - a) * fx, bottom = c + (d - c) * fx;
+                height += amplitude * (top + (bottom - top) * fz);
+                amplitude /= 2.0f;
+            }
+            int h = (int)height;
+            for (int y = -1; y <= h; y++) {
+                BlockType bt = grass;
+                if (h <= 1)
+                    bt = water;
+                else if (y < h)
+                    bt = grey;
+                blocks.emplace_back(glm::vec3((float)x, (float)y, (float)z), bt, true);
+            }
+        }
+    }
+}
+
+// Benchmark script: the world, a camera path and the edits made along it.
+//
+//     seed 1234           terrain from generateSeededWorld()
+//     world 64            blocks across
+//     save DIR            or load a saved world instead
+//     frames 600          frames measured
+//     warmup 30           frames run first, once textures are loaded
+//     dt 0.0166667        simulated seconds per frame
+//     key F X Y Z YAW PITCH
+//     place F
+//     destroy F
+//
+// The camera moves linearly between keys; place and destroy act on the block
+// the camera looks at on frame F. Lines starting with # are comments.
+struct FlythroughKey {
+    int Frame;
+    glm::vec3 Position;
+    float Yaw, Pitch;
+};
+
+struct FlythroughEdit {
+    int Frame;
+    bool Place;
+};
+
+class FlythroughScript {
+public:
+    std::string Path;
+    uint32_t Seed = 1;
+    int WorldSize = 64;
+    std::string SavePath;
+    int Frames = 600;
+    int Warmup = 30;
+    float DeltaTime = 1.0f / 60.0f;
+    std::vector<FlythroughKey> Keys;
+    std::vector<FlythroughEdit> Edits;
+
+    bool Load(const std::string& path) {
+        Path = path;
+        std::ifstream file(path);
+        if (!file) {
+            std::cout << "ERROR::BENCHMARK::SCRIPT_NOT_FOUND " << path << std::endl;
+            return false;
+        }
+        std::string line;
+        int number = 0;
+        while (std::getline(file, line)) {
+            number++;
+            std::istringstream in(line);
+            std::string command;
+            if (!(in >> command) || command[0] == '#')
+                continue;
+            bool ok = true;
+            if (command == "seed")
+                ok = (bool)(in >> Seed);
+            else if (command == "world")
+                ok = (bool)(in >> WorldSize);
+            else if (command == "save")
+                ok = (bool)(in >> SavePath);
+            else if (command == "frames")
+                ok = (bool)(in >> Frames);
+            else if (command == "warmup")
+                ok = (bool)(in >> Warmup);
+            else if (command == "dt")
+                ok = (bool)(in >> DeltaTime);
+            else if (command == "key") {
+                FlythroughKey key;
+                ok = (bool)(in >> key.Frame >> key.Position.x >> key.Position.y >> key.Position.z >> key.Yaw >> key.Pitch);
+                ok = ok && (Keys.empty() || key.Frame > Keys.back().Frame);
+                Keys.push_back(key);
+            }
+            else if (command == "place" || command == "destroy") {
+                FlythroughEdit edit;
+                edit.Place = command == "place";
+                ok = (bool)(in >> edit.Frame);
+                Edits.push_back(edit);
+            }
+            else
+                ok = false;
+            if (!ok) {
+                std::cout << "ERROR::BENCHMARK::BAD_LINE " << path << ":" << number << ": " << line << std::endl;
+                return false;
+            }
+        }
+        if (Keys.empty()) {
+            std::cout << "ERROR::BENCHMARK::NO_CAMERA_PATH " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool BuildWorld(std::vector<Block>& blocks) const {
+        blocks.clear();
+        if (SavePath.empty()) {
+            generateSeededWorld(Seed, WorldSize, blocks);
+            return true;
+        }
+        WorldSave save(SavePath);
+        if (!save.Load(blocks)) {
+            std::cout << "ERROR::BENCHMARK::SAVE_NOT_FOUND " << SavePath << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // the camera pose on a frame, between the keys either side of it
+    FlythroughKey Pose(int frame) const {
+        if (frame <= Keys.front().Frame)
+            return Keys.front();
+        for (size_t i = 1; i < Keys.size(); i++) {
+            if (frame <= Keys[i].Frame) {
+                const FlythroughKey& a = Keys[i - 1];
+                const FlythroughKey& b = Keys[i];
+                float t = (float)(frame - a.Frame) / (float)(b.Frame - a.Frame);
+                FlythroughKey pose;
+                pose.Frame = frame;
+                pose.Position = a.Position + (b.Position - a.Position) * t;
+                pose.Yaw = a.Yaw + (b.Yaw - a.Yaw) * t;
+                pose.Pitch = a.Pitch + (b.Pitch - a.Pitch) * t;
+                return pose;
+            }
+        }
+        return Keys.back();
+    }
+};
+
+// Runs a FlythroughScript against the main loop: BeginFrame() poses the
+// camera and makes the frame's edits, EndFrame() takes the frame's time and
+// render stats. Nothing is measured until the textures have loaded and the
+// warmup frames have run, so every run measures the same frames.
+class FlythroughBenchmark {
+public:
+    FlythroughBenchmark(const FlythroughScript& script) : script(script) {
+        frames.reserve(script.Frames);
+    }
+
+    // Simulation thread: poses the camera and makes the frame's edits.
+    // ready is false while the renderer is still streaming in resources.
+    // Returns the script frame, to pass to EndFrame() once it is rendered, or
+    // -1 while warming up.
+    int BeginFrame(Camera& camera, bool ready) {
+        if (!measuring) {
+            warmup = ready ? warmup + 1 : 0;
+            measuring = warmup > script.Warmup;
+        }
+        int frame = measuring ? simulated : 0;
+        FlythroughKey pose = script.Pose(frame);
+        camera.SetPose(pose.Position, pose.Yaw, pose.Pitch);
+        if (!measuring)
+            return -1;
+        simulated++;
+        if (frame == 0)
+            startBlocks = camera.Blocks->size();
+        for (const FlythroughEdit& edit : script.Edits) {
+            if (edit.Frame != frame)
+                continue;
+            if (edit.Place)
+                camera.PlaceBlock();
+            else
+                camera.DestroyBlock();
+        }
+        endBlocks = camera.Blocks->size();
+        return frame;
+    }
+
+    // Render thread: records a frame that BeginFrame() returned a script
+    // frame for.
+    void EndFrame(const FrameStats& stats, double milliseconds) {
+        if (Done())
+            return;
+        FrameStats frame = stats;
+        frame.Milliseconds = milliseconds;
+        frames.push_back(frame);
+        histogram.Record((uint64_t)(milliseconds * 1000.0));
+    }
+
+    // every script frame has been simulated
+    bool Simulated() const {
+        return simulated >= script.Frames;
+    }
+
+    // and rendered
+    bool Done() const {
+        return (int)frames.size() >= script.Frames;
+    }
+
+    void Report() const {
+        if (frames.empty())
+            return;
+        printf("benchmark %s: %zu frames, p50 %.2f  p95 %.2f  p99 %.2f  max %.2f ms\n", script.Path.c_str(), frames.size(),
+               histogram.Percentile(50) / 1000.0, histogram.Percentile(95) / 1000.0,
+               histogram.Percentile(99) / 1000.0, histogram.Max() / 1000.0);
+        fflush(stdout);
+    }
+
+    bool WriteReport(const std::string& path) const {
+        FILE* f = fopen(path.c_str(), "w");
+        if (f == NULL) {
+            std::cout << "ERROR::BENCHMARK::REPORT_NOT_WRITTEN " << path << std::endl;
+            return false;
+        }
+        FrameStats total;
+        for (const FrameStats& s : frames) {
+            total.Milliseconds += s.Milliseconds;
+            total.DrawCalls += s.DrawCalls;
+            total.Triangles += s.Triangles;
+            total.Vertices += s.Vertices;
+            total.ProgramBinds += s.ProgramBinds;
+            total.TextureBinds += s.TextureBinds;
+            total.VertexArrayBinds += s.VertexArrayBinds;
+            total.UniformCalls += s.UniformCalls;
+            total.UniformBytes += s.UniformBytes;
+            total.BufferBytes += s.BufferBytes;
+            total.TextureBytes += s.TextureBytes;
+        }
+        double n = frames.empty() ? 1.0 : (double)frames.size();
+
+        fprintf(f, "{\n");
+        fprintf(f, "  \"script\": \"%s\",\n", escape(script.Path).c_str());
+        if (script.SavePath.empty())
+            fprintf(f, "  \"world\": { \"seed\": %u, \"size\": %d, \"blocks_start\": %zu, \"blocks_end\": %zu },\n",
+                    script.Seed, script.WorldSize, startBlocks, endBlocks);
+        else
+            fprintf(f, "  \"world\": { \"save\": \"%s\", \"blocks_start\": %zu, \"blocks_end\": %zu },\n",
+                    escape(script.SavePath).c_str(), startBlocks, endBlocks);
+        fprintf(f, "  \"frames\": %zu,\n", frames.size());
+        fprintf(f, "  \"dt\": %g,\n", script.DeltaTime);
+        fprintf(f, "  \"frame_ms\": { \"mean\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f },\n",
+                total.Milliseconds / n, histogram.Percentile(50) / 1000.0, histogram.Percentile(95) / 1000.0,
+                histogram.Percentile(99) / 1000.0, histogram.Max() / 1000.0);
+        fprintf(f, "  \"totals\": { \"draws\": %llu, \"triangles\": %llu, \"vertices\": %llu, \"program_binds\": %llu, "
+                   "\"texture_binds\": %llu, \"vao_binds\": %llu, \"uniforms\": %llu, \"uniform_bytes\": %llu, "
+                   "\"buffer_bytes\": %llu, \"texture_bytes\": %llu },\n",
+                (unsigned long long)total.DrawCalls, (unsigned long long)total.Triangles, (unsigned long long)total.Vertices,
+                (unsigned long long)total.ProgramBinds, (unsigned long long)total.TextureBinds, (unsigned long long)total.VertexArrayBinds,
+                (unsigned long long)total.UniformCalls, (unsigned long long)total.UniformBytes,
+                (unsigned long long)total.BufferBytes, (unsigned long long)total.TextureBytes);
+        fprintf(f, "  \"per_frame\": [\n");
+        for (size_t i = 0; i < frames.size(); i++) {
+            const FrameStats& s = frames[i];
+            fprintf(f, "    { \"ms\": %.3f, \"draws\": %llu, \"triangles\": %llu, \"uniforms\": %llu }%s\n", s.Milliseconds,
+                    (unsigned long long)s.DrawCalls, (unsigned long long)s.Triangles, (unsigned long long)s.UniformCalls,
+                    i + 1 < frames.size() ? "," : "");
+        }
+        fprintf(f, "  ]\n}\n");
+        bool ok = ferror(f) == 0;
+        fclose(f);
+        std::cout << "wrote benchmark report to " << path << std::endl;
+        return ok;
+    }
+
+private:
+    const FlythroughScript& script;
+    std::vector<FrameStats> frames;
+    LatencyHistogram histogram;
+    int warmup = 0;
+    bool measuring = false;     // simulation thread only
+    int simulated = 0;
+    size_t startBlocks = 0, endBlocks = 0;
+
+    static std::string escape(const std::string& s) {
+        std::string out;
+        for (char c : s) {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            out += c;
+        }
+        return out;
+    }
+};
+
+#endif
@@ -14,6 +14,18 @@ enum BlockType {
 	grey = 6,
 };
 
+// layer of the block texture array (tools/bake_textures) used for the
+// top, side and bottom faces of each block type
+const int BlockTextureLayers[][3] = {
+	{ 0, 1, 2 },	// grass
+	{ 3, 3, 3 },	// water
+	{ 4, 4, 4 },	// red
+	{ 5, 5, 5 },	// yellow
+	{ 6, 6, 6 },	// purple
+	{ 7, 7, 7 },	// cyan
+	{ 8, 8, 8 },	// grey
+};
+
 class Block {
 public:
 	glm::vec3 position;
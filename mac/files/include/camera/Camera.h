@@ -8,6 +8,8 @@
 #include <vector>
 #include <math.h>
 #include "block/Block.h"
+#include "profile/Profiler.h"
+#include "log/Logger.h"
 
 
 enum Camera_Movement {
@@ -56,6 +58,8 @@ public:
     bool blockFound = false;
     bool leftClicked = false;
     bool rightClicked = false;
+    // called after a block is placed (placed = true) or before it is removed
+    void (*OnBlockEdit)(const Block& block, bool placed) = nullptr;
 
     Camera(std::vector<Block>* blocks, glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM) {
         Position = position;
@@ -79,6 +83,19 @@ public:
         return glm::lookAt(Position, Position + Front, Up);
     }
 
+    // the view from another eye position, such as one between two ticks
+    glm::mat4 GetViewMatrix(glm::vec3 position) {
+        return glm::lookAt(position, position + Front, Up);
+    }
+
+    // the view a camera at position with these angles would have, for
+    // re-aiming a view with mouse movement newer than the camera's
+    static glm::mat4 GetViewMatrix(glm::vec3 position, float yaw, float pitch, glm::vec3 worldUp = glm::vec3(0.0f, 1.0f, 0.0f)) {
+        glm::vec3 front = frontVector(yaw, pitch);
+        glm::vec3 right = glm::normalize(glm::cross(front, worldUp));
+        return glm::lookAt(position, position + front, glm::normalize(glm::cross(right, front)));
+    }
+
     void ProcessKeyboard(Camera_Movement direction, float deltaTime) {
         float velocity = MovementSpeed * deltaTime;
         glm::vec3 prevPos = Position;
@@ -96,7 +113,7 @@ public:
         if (direction == RIGHT)
             Position += mRight * velocity;
 
-        for (Block b : *Blocks) {
+        for (const Block& b : *Blocks) {
             if (inRange(0, 2, Position.y - b.position.y)) {
                 if (Position.x < b.position.x + 1.3 && Position.x > b.position.x - 0.3) {
                     if (Position.z < b.position.z + 1.3 && prevPos.z >= b.position.z + 1.3) {
@@ -134,6 +151,14 @@ public:
         updateCameraVectors();
         //updateLook();
     }
+
+    // moves the camera straight to a pose, as a scripted path does
+    void SetPose(glm::vec3 position, float yaw, float pitch) {
+        Position = position;
+        Yaw = yaw;
+        Pitch = std::fmin(89.0f, std::fmax(-89.0f, pitch));
+        updateCameraVectors();
+    }
     void Sprint() {
         if (!sprinting) {
             sprinting = true;
@@ -155,17 +180,52 @@ public:
         bHopProt = false;
     }
 
+    // falls under gravity onto the highest block below, or stands on it
+    void ProcessGravity(float deltaTime) {
+        float x = floor(Position.x);
+        float z = floor(Position.z);
+        float highest = -INFINITY;
+        for (const Block& b : *Blocks) {
+            if (b.position.x == x && b.position.z == z) {
+                highest = std::fmax(highest, b.position.y);
+            }
+        }
+        Position.y = std::fmax(highest + 2.9f, Position.y + YVelocity * deltaTime);
+        if (Position.y < killPlane) {
+            Position = glm::vec3(0, 2.9, 0);
+        }
+        if (Position.y == highest + 2.9f) {
+            YVelocity = 0;
+            Gravity = -9.81f;
+            grounded = true;
+        }
+        else {
+            YVelocity += deltaTime * Gravity;
+            YVelocity = fmax(TerminalVelocity, YVelocity);
+        }
+    }
+
+    // index of the block at position, or -1
+    int FindBlock(glm::vec3 position) const {
+        for (int i = 0; i < (*Blocks).size(); i++) {
+            const Block& b = (*Blocks)[i];
+            if (b.position == position) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
     void PlaceBlock() {
         updateLook();
         if (NextBlock != (glm::vec3)NULL) {
-            for (int i = 0; i < (*Blocks).size(); i++) {
-                Block b = (*Blocks)[i];
-                if (b.position == NextBlock) {
-                    return;
-                }
+            if (FindBlock(NextBlock) != -1) {
+                return;
             }
             (*Blocks).emplace_back(NextBlock, grass, true);
-            std::cout << "Block placed at (" << NextBlock.x << ", " << NextBlock.y << ", " << NextBlock.z << ")" << std::endl;
+            if (OnBlockEdit)
+                OnBlockEdit((*Blocks).back(), true);
+            LOG_INFO("Block placed at ({}, {}, {})", NextBlock.x, NextBlock.y, NextBlock.z);
         }
         updateLook();
     }
@@ -173,7 +233,10 @@ public:
     void DestroyBlock() {
         updateLook();
         if (CurrentBlockIndex != Blocks->size() && CurrentBlockIndex != -1) {
-            std::cout << "Block removed at (" << (*Blocks)[CurrentBlockIndex].position.x << ", " << (*Blocks)[CurrentBlockIndex].position.y << ", " << (*Blocks)[CurrentBlockIndex].position.z << ")" << std::endl;
+            const glm::vec3& removed = (*Blocks)[CurrentBlockIndex].position;
+            LOG_INFO("Block removed at ({}, {}, {})", removed.x, removed.y, removed.z);
+            if (OnBlockEdit)
+                OnBlockEdit((*Blocks)[CurrentBlockIndex], false);
             (*Blocks).erase((*Blocks).begin() + CurrentBlockIndex);
         }
         //Blocks->erase();
@@ -182,21 +245,30 @@ public:
 
 
 private:
+    // unit vector a camera with these Euler angles looks along
+    static glm::vec3 frontVector(float yaw, float pitch)
+    {
+        glm::vec3 front;
+        front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
+        front.y = sin(glm::radians(pitch));
+        front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
+        return glm::normalize(front);
+    }
+
     // calculates Front vector from Camera's Euler angles
     void updateCameraVectors()
     {
         // Calculate the new Front vector
-        glm::vec3 front;
-        front.x = cos(glm::radians(Yaw)) * cos(glm::radians(Pitch));
-        front.y = sin(glm::radians(Pitch));
-        front.z = sin(glm::radians(Yaw)) * cos(glm::radians(Pitch));
-        Front = glm::normalize(front);
+        Front = frontVector(Yaw, Pitch);
         // Also re-calculate the Right and Up vector
         Right = glm::normalize(glm::cross(Front, WorldUp));  // Normalize the vectors, because their length gets closer to 0 the more you look up or down which results in slower movement.
         Up = glm::normalize(glm::cross(Right, Front));
     }
 
+public:
+    // finds the block in view (CurrentBlockIndex) and the cell a placed block would fill (NextBlock)
     void updateLook() {    // with inspiration from https://gamedev.stackexchange.com/questions/47362/cast-ray-to-select-block-in-voxel-game?rq=1
+        PROFILE_SCOPE("updateLook");
         glm::vec3 rayEnd = Position + maxSelectDist * Front;
         glm::vec3 curr = Position;
         glm::vec3 candidate;
@@ -265,7 +337,7 @@ private:
             candidate = glm::vec3(int(floor(curr.x)), int(floor(curr.y)), int(floor(curr.z)));
 
             for (int i = 0; i < vecRef.size(); i++) {
-                Block b = vecRef[i];
+                const Block& b = vecRef[i];
                 if (b.position == candidate) {
                     CurrentBlockIndex = i;
                     blockFound = true;
@@ -282,6 +354,7 @@ private:
         }
     }
 
+private:
     int signum(float x) {
         return x > 0 ? 1 : x < 0 ? -1 : 0;
     }
@@ -0,0 +1,106 @@
+#ifndef PNG_WRITER_H
+#define PNG_WRITER_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+// Minimal PNG encoder for frame captures: 8-bit RGBA, no filtering, and
+// deflate "stored" blocks, so there is no compression but also no zlib.
+
+inline uint32_t pngCrc(const unsigned char* data, size_t length, uint32_t crc = 0xffffffff)
+{
+    static uint32_t table[256];
+    static bool built = false;
+    if (!built)
+    {
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        built = true;
+    }
+    for (size_t i = 0; i < length; i++)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+inline void pngPut32(std::vector<unsigned char>& out, uint32_t v)
+{
+    out.push_back(v >> 24);
+    out.push_back(v >> 16);
+    out.push_back(v >> 8);
+    out.push_back(v);
+}
+
+inline void pngChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data)
+{
+    pngPut32(out, (uint32_t)data.size());
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    pngPut32(out, pngCrc(out.data() + start, out.size() - start) ^ 0xffffffff);
+}
+
+// rgba is width * height * 4 bytes; flip for bottom-up data from glReadPixels
+inline bool writePng(const std::string& path, int width, int height, const unsigned char* rgba, bool flipVertically = false)
+{
+    // scanlines, each prefixed with filter type 0
+    std::vector<unsigned char> raw;
+    raw.reserve((size_t)(width * 4 + 1) * height);
+    for (int y = 0; y < height; y++)
+    {
+        int row = flipVertically ? height - 1 - y : y;
+        raw.push_back(0);
+        raw.insert(raw.end(), rgba + (size_t)row * width * 4, rgba + (size_t)(row + 1) * width * 4);
+    }
+
+    // zlib stream of stored blocks
+    std::vector<unsigned char> zlib = { 0x78, 0x01 };
+    uint32_t a = 1, b = 0;
+    size_t pos = 0;
+    do
+    {
+        size_t length = raw.size() - pos < 65535 ? raw.size() - pos : 65535;
+        zlib.push_back(pos + length == raw.size() ? 1 : 0);
+        zlib.push_back(length & 0xff);
+        zlib.push_back(length >> 8);
+        zlib.push_back(~length & 0xff);
+        zlib.push_back((~length >> 8) & 0xff);
+        for (size_t i = pos; i < pos + length; i++)
+        {
+            zlib.push_back(raw[i]);
+            a = (a + raw[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        pos += length;
+    } while (pos < raw.size());
+    pngPut32(zlib, (b << 16) | a);
+
+    std::vector<unsigned char> header;
+    pngPut32(header, width);
+    pngPut32(header, height);
+    header.push_back(8);    // bit depth
+    header.push_back(6);    // RGBA
+    header.push_back(0);
+    header.push_back(0);
+    header.push_back(0);
+
+    std::vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    pngChunk(png, "IHDR", header);
+    pngChunk(png, "IDAT", zlib);
+    pngChunk(png, "IEND", std::vector<unsigned char>());
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if (f == NULL)
+        return false;
+    bool written = fwrite(png.data(), 1, png.size(), f) == png.size();
+    fclose(f);
+    return written;
+}
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef INPUT_QUEUE_H
+#define INPUT_QUEUE_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+
+enum InputEventType {
+    INPUT_KEY,          // Code is the GLFW key, Action press, release or repeat
+    INPUT_MOUSE_BUTTON, // Code is the GLFW button
+    INPUT_CURSOR        // X, Y is the cursor position
+};
+
+struct InputEvent {
+    InputEventType Type;
+    int Code;
+    int Action;
+    double X, Y;
+    double Time;        // seconds, on the backend's clock
+};
+
+// Window input as it happened, for the simulation to apply at a fixed point
+// in its tick instead of from inside the window system's callbacks. One
+// thread pushes (the one polling events) and one pops (the simulation), so
+// the queue takes no lock. A full queue drops the event and counts it.
+class InputQueue {
+public:
+    static const size_t CAPACITY = 1024;
+
+    bool Push(const InputEvent& event) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == CAPACITY) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        events[h & (CAPACITY - 1)] = event;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(InputEvent& event) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+            return false;
+        event = events[t & (CAPACITY - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint64_t Dropped() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    InputEvent events[CAPACITY];
+    std::atomic<uint64_t> head { 0 };   // written by the producer
+    std::atomic<uint64_t> tail { 0 };   // written by the consumer
+    std::atomic<uint64_t> dropped { 0 };
+};
+
+// The newest cursor position, written by the thread polling events as each
+// one arrives and read by any other at any time, without a lock: a reader
+// retries while a write is under way, so it never sees a torn position.
+class CursorLatch {
+public:
+    void Store(double x, double y, double time) {
+        uint64_t s = sequence.load(std::memory_order_relaxed);
+        sequence.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        this->x.store(x, std::memory_order_relaxed);
+        this->y.store(y, std::memory_order_relaxed);
+        this->time.store(time, std::memory_order_relaxed);
+        sequence.store(s + 2, std::memory_order_release);
+    }
+
+    // false until the first Store()
+    bool Load(double& x, double& y, double& time) const {
+        uint64_t before, after;
+        do {
+            before = sequence.load(std::memory_order_acquire);
+            x = this->x.load(std::memory_order_relaxed);
+            y = this->y.load(std::memory_order_relaxed);
+            time = this->time.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while (before != after || (before & 1) != 0);
+        return before != 0;
+    }
+
+private:
+    std::atomic<uint64_t> sequence { 0 };   // odd while a Store() is under way
+    std::atomic<double> x { 0.0 }, y { 0.0 }, time { 0.0 };
+};
+
+// Input events with the tick that applied them, written out after a run
+// and fed back in on the same ticks to replay it. One event per line:
+// tick type code action x y time.
+class InputRecording {
+public:
+    struct Entry {
+        uint64_t Tick;
+        InputEvent Event;
+    };
+
+    std::vector<Entry> Entries;
+
+    InputRecording() {
+        Entries.reserve(4096);
+    }
+
+    void Record(uint64_t tick, const InputEvent& event) {
+        Entries.push_back({ tick, event });
+    }
+
+    // pushes the events recorded for tick; call with increasing ticks
+    void Replay(uint64_t tick, InputQueue& queue) {
+        while (next < Entries.size() && Entries[next].Tick <= tick)
+            queue.Push(Entries[next++].Event);
+    }
+
+    bool Finished() const {
+        return next >= Entries.size();
+    }
+
+    bool Save(const std::string& path) const {
+        FILE* f = fopen(path.c_str(), "w");
+        if (f == NULL) {
+            std::cout << "ERROR::INPUT::RECORDING_NOT_WRITTEN " << path << std::endl;
+            return false;
+        }
+        for (const Entry& e : Entries)
+            fprintf(f, "%llu %d %d %d %.17g %.17g %.17g\n", (unsigned long long)e.Tick, (int)e.Event.Type, e.Event.Code,
+                    e.Event.Action, e.Event.X, e.Event.Y, e.Event.Time);
+        bool ok = ferror(f) == 0;
+        fclose(f);
+        std::cout << "wrote " << Entries.size() << " input events to " << path << std::endl;
+        return ok;
+    }
+
+    bool Load(const std::string& path) {
+        FILE* f = fopen(path.c_str(), "r");
+        if (f == NULL) {
+            std::cout << "ERROR::INPUT::RECORDING_NOT_READ " << path << std::endl;
+            return false;
+        }
+        Entries.clear();
+        next = 0;
+        unsigned long long tick;
+        int type;
+        Entry e;
+        while (fscanf(f, "%llu %d %d %d %lf %lf %lf", &tick, &type, &e.Event.Code, &e.Event.Action,
+                      &e.Event.X, &e.Event.Y, &e.Event.Time) == 7) {
+            e.Tick = tick;
+            e.Event.Type = (InputEventType)type;
+            Entries.push_back(e);
+        }
+        fclose(f);
+        return true;
+    }
+
+private:
+    size_t next = 0;
+};
+
+#endif
@@ -0,0 +1,280 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// Asynchronous logging.
+//
+// LOG_INFO("Block placed at ({}, {}, {})", x, y, z) copies the format string
+// pointer and the raw arguments into the calling thread's ring buffer and
+// returns; nothing is formatted or written on the calling thread. A writer
+// thread drains every ring, replaces each {} with the next argument and
+// writes the lines to stdout in time order. Rings have one writer and one
+// reader, so logging takes no lock. A full ring drops the record and counts
+// it. Levels below LOG_MIN_LEVEL compile to nothing. Formats must be string
+// literals; string arguments are copied.
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR 3
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_AT(level, ...) \
+    do { if ((level) >= LOG_MIN_LEVEL) Logger::Get().Write((level), __VA_ARGS__); } while (0)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(LOG_LEVEL_WARNING, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+// byte ring with one producing and one consuming thread
+struct LogRing {
+    static const size_t CAPACITY = 1 << 16;
+
+    std::vector<unsigned char> bytes;
+    std::atomic<uint64_t> head { 0 };   // written by the producer
+    std::atomic<uint64_t> tail { 0 };   // written by the consumer
+    std::atomic<uint64_t> dropped { 0 };
+
+    LogRing() : bytes(CAPACITY) {}
+
+    bool push(const unsigned char* data, size_t size) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (CAPACITY - (h - tail.load(std::memory_order_acquire)) < size) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        copyIn(h, data, size);
+        head.store(h + size, std::memory_order_release);
+        return true;
+    }
+
+    void copyIn(uint64_t at, const unsigned char* data, size_t size) {
+        size_t offset = at & (CAPACITY - 1);
+        size_t first = std::min(size, CAPACITY - offset);
+        memcpy(&bytes[offset], data, first);
+        memcpy(&bytes[0], data + first, size - first);
+    }
+
+    void copyOut(uint64_t at, unsigned char* data, size_t size) const {
+        size_t offset = at & (CAPACITY - 1);
+        size_t first = std::min(size, CAPACITY - offset);
+        memcpy(data, &bytes[offset], first);
+        memcpy(data + first, &bytes[0], size - first);
+    }
+};
+
+class Logger {
+public:
+    static const size_t MAX_RECORD = 4096;
+
+    static Logger& Get() {
+        static Logger logger;
+        return logger;
+    }
+
+    ~Logger() {
+        stopping.store(true, std::memory_order_release);
+        if (writer.joinable())
+            writer.join();
+    }
+
+    template <typename... Args>
+    void Write(int level, const char* format, const Args&... args) {
+        unsigned char record[MAX_RECORD];
+        Header header;
+        header.level = (uint8_t)level;
+        header.time = std::chrono::steady_clock::now().time_since_epoch().count();
+        header.format = format;
+        unsigned char* end = encode(record + sizeof(Header), record + MAX_RECORD, args...);
+        header.size = (uint32_t)(end - record);
+        memcpy(record, &header, sizeof(Header));
+        ring().push(record, header.size);
+    }
+
+    // sets up the calling thread's ring now, so that its first log line does
+    // not allocate
+    void Register() {
+        ring();
+    }
+
+    // blocks until everything logged so far has been written
+    void Flush() {
+        while (pending())
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        fflush(stdout);
+    }
+
+    uint64_t Dropped() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t dropped = 0;
+        for (auto& r : rings)
+            dropped += r->dropped.load(std::memory_order_relaxed);
+        return dropped;
+    }
+
+private:
+    enum ArgType : uint8_t { ARG_INT, ARG_UINT, ARG_DOUBLE, ARG_BOOL, ARG_CHAR, ARG_STRING };
+
+    struct Header {
+        uint32_t size;      // of the whole record
+        uint8_t level;
+        int64_t time;
+        const char* format;
+    };
+
+    struct Line {
+        int64_t time;
+        std::string text;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<LogRing>> rings;
+    std::thread writer;
+    std::atomic<bool> stopping { false };
+
+    Logger() {
+        writer = std::thread(&Logger::run, this);
+    }
+
+    LogRing& ring() {
+        thread_local LogRing* current = nullptr;
+        if (current == nullptr) {
+            std::lock_guard<std::mutex> lock(mutex);
+            rings.emplace_back(new LogRing());
+            current = rings.back().get();
+        }
+        return *current;
+    }
+
+    bool pending() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& r : rings) {
+            if (r->tail.load(std::memory_order_acquire) != r->head.load(std::memory_order_acquire))
+                return true;
+        }
+        return false;
+    }
+
+    // argument encoding: a type byte, then the value; strings carry a length
+    static unsigned char* encode(unsigned char* p, unsigned char*) {
+        return p;
+    }
+
+    template <typename T, typename... Rest>
+    static unsigned char* encode(unsigned char* p, unsigned char* end, const T& value, const Rest&... rest) {
+        return encode(put(p, end, value), end, rest...);
+    }
+
+    template <typename T>
+    static unsigned char* putValue(unsigned char* p, unsigned char* end, ArgType type, T value) {
+        if (end - p < (ptrdiff_t)(1 + sizeof(T)))
+            return p;
+        *p = type;
+        memcpy(p + 1, &value, sizeof(T));
+        return p + 1 + sizeof(T);
+    }
+
+    static unsigned char* putString(unsigned char* p, unsigned char* end, const char* s, size_t length) {
+        if (end - p < 3)
+            return p;
+        length = std::min(length, (size_t)(end - p - 3));
+        *p = ARG_STRING;
+        uint16_t n = (uint16_t)std::min(length, (size_t)UINT16_MAX);
+        memcpy(p + 1, &n, 2);
+        memcpy(p + 3, s, n);
+        return p + 3 + n;
+    }
+
+    static unsigned char* put(unsigned char* p, unsigned char* end, int v) { return putValue(p, end, ARG_INT, (int64_t)v); }
+    static unsigned char* put(unsigned char* p, unsigned char* end, long v) { return putValue(p, end, ARG_INT, (int64_t)v); }
+    static unsigned char* put(unsigned char* p, unsigned char* end, long long v) { return putValue(p, end, ARG_INT, (int64_t)v); }
+    static unsigned char* put(unsigned char* p, unsigned char* end, unsigned int v) { return putValue(p, end, ARG_UINT, (uint64_t)v); }
+    static unsigned char* put(unsigned char* p, unsigned char* end, unsigned long v) { return putValue(p, end, ARG_UINT, (uint64_t)v); }
+    static unsigned char* put(unsigned char* p, unsigned char* end, unsigned long long v) { return putValue(p, end, ARG_UINT, (uint64_t)v); }
+    static unsigned char* put(unsigned char* p, unsigned char* end, float v) { return putValue(p, end, ARG_DOUBLE, (double)v); }
+    static unsigned char* put(unsigned char* p, unsigned char* end, double v) { return putValue(p, end, ARG_DOUBLE, v); }
+    static unsigned char* put(unsigned char* p, unsigned char* end, bool v) { return putValue(p, end, ARG_BOOL, (uint8_t)v); }
+    static unsigned char* put(unsigned char* p, unsigned char* end, char v) { return putValue(p, end, ARG_CHAR, v); }
+    static unsigned char* put(unsigned char* p, unsigned char* end, const char* s) { return putString(p, end, s, strlen(s)); }
+    static unsigned char* put(unsigned char* p, unsigned char* end, char* s) { return putString(p, end, s, strlen(s)); }
+    static unsigned char* put(unsigned char* p, unsigned char* end, const std::string& s) { return putString(p, end, s.data(), s.size()); }
+
+    // writer thread: drain the rings, format and write in time order
+    void run() {
+        std::vector<Line> lines;
+        std::vector<unsigned char> record(MAX_RECORD);
+        while (true) {
+            bool stop = stopping.load(std::memory_order_acquire);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (auto& r : rings) {
+                    uint64_t tail = r->tail.load(std::memory_order_relaxed);
+                    uint64_t head = r->head.load(std::memory_order_acquire);
+                    while (tail != head) {
+                        Header header;
+                        r->copyOut(tail, (unsigned char*)&header, sizeof(Header));
+                        r->copyOut(tail, record.data(), header.size);
+                        lines.push_back({ header.time, format(header, record.data() + sizeof(Header), record.data() + header.size) });
+                        tail += header.size;
+                    }
+                    r->tail.store(tail, std::memory_order_release);
+                }
+            }
+            if (!lines.empty()) {
+                std::stable_sort(lines.begin(), lines.end(), [](const Line& a, const Line& b) { return a.time < b.time; });
+                for (const Line& line : lines)
+                    fwrite(line.text.data(), 1, line.text.size(), stdout);
+                fflush(stdout);
+                lines.clear();
+            }
+            else if (stop) {
+                return;
+            }
+            else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        }
+    }
+
+    static std::string format(const Header& header, const unsigned char* args, const unsigned char* end) {
+        std::string out;
+        char number[32];
+        for (const char* f = header.format; *f; f++) {
+            if (f[0] != '{' || f[1] != '}') {
+                out += *f;
+                continue;
+            }
+            f++;
+            if (args >= end)
+                continue;
+            ArgType type = (ArgType)*args++;
+            switch (type) {
+                case ARG_INT: { int64_t v; memcpy(&v, args, 8); args += 8; snprintf(number, sizeof(number), "%lld", (long long)v); out += number; break; }
+                case ARG_UINT: { uint64_t v; memcpy(&v, args, 8); args += 8; snprintf(number, sizeof(number), "%llu", (unsigned long long)v); out += number; break; }
+                case ARG_DOUBLE: { double v; memcpy(&v, args, 8); args += 8; snprintf(number, sizeof(number), "%g", v); out += number; break; }
+                case ARG_BOOL: out += *args++ ? "true" : "false"; break;
+                case ARG_CHAR: out += (char)*args++; break;
+                case ARG_STRING: { uint16_t n; memcpy(&n, args, 2); out.append((const char*)args + 2, n); args += 2 + n; break; }
+            }
+        }
+        out += '\n';
+        return out;
+    }
+};
+
+#endif
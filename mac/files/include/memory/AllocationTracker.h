@@ -0,0 +1,173 @@
+#ifndef ALLOCATION_TRACKER_H
+#define ALLOCATION_TRACKER_H
+
+#include <new>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+
+// Heap allocation tracking through the global operator new.
+//
+// Every operator new on a thread bumps that thread's counters, read with
+// AllocationTracker::Count() and Bytes(), so a frame loop can check that it
+// did not allocate. While tracing is on for a thread, its next allocation
+// prints a backtrace to stderr so the caller can be found, and turns
+// tracing off. The replacement operators are compiled into the one file that
+// defines ALLOCATION_TRACKER_IMPLEMENTATION before including this header;
+// defining ALLOCATION_TRACKER_DISABLED leaves the standard ones in place and
+// the counts at 0.
+class AllocationTracker {
+public:
+    // allocations made by the calling thread so far
+    static uint64_t Count() {
+        return counters().count;
+    }
+
+    static uint64_t Bytes() {
+        return counters().bytes;
+    }
+
+    // backtrace the calling thread's next allocation, if it comes before
+    // tracing is turned off again
+    static void Trace(bool on) {
+        counters().trace = on;
+    }
+
+    static bool Enabled() {
+#if defined(ALLOCATION_TRACKER_DISABLED)
+        return false;
+#else
+        return true;
+#endif
+    }
+
+    struct Counters {
+        uint64_t count;
+        uint64_t bytes;
+        bool trace;
+    };
+
+    // zero-initialised thread-local storage, safe to touch from operator new
+    static Counters& counters() {
+        static thread_local Counters c = { 0, 0, false };
+        return c;
+    }
+};
+
+// Checks that one thread's frames do not allocate. Begin() and End()
+// bracket a frame on that thread; a checked frame that allocated is logged
+// and counted, and the first one also gets its allocation backtraced.
+class FrameAllocationCheck {
+public:
+    FrameAllocationCheck(const char* thread) : thread(thread) {}
+
+    void Begin(bool check) {
+        checking = check;
+        count = AllocationTracker::Count();
+        bytes = AllocationTracker::Bytes();
+        AllocationTracker::Trace(check && allocatingFrames == 0);
+    }
+
+    void End(uint64_t frame) {
+        AllocationTracker::Trace(false);
+        uint64_t allocations = AllocationTracker::Count() - count;
+        if (!checking || allocations == 0)
+            return;
+        printf("ERROR::ALLOCATION::FRAME_ALLOCATED %s frame %llu: %llu allocation(s), %llu bytes\n", thread,
+               (unsigned long long)frame, (unsigned long long)allocations,
+               (unsigned long long)(AllocationTracker::Bytes() - bytes));
+        allocatingFrames++;
+    }
+
+    // checked frames that allocated
+    uint64_t AllocatingFrames() const {
+        return allocatingFrames;
+    }
+
+private:
+    const char* thread;
+    bool checking = false;
+    uint64_t count = 0, bytes = 0;
+    uint64_t allocatingFrames = 0;
+};
+
+#if defined(ALLOCATION_TRACKER_IMPLEMENTATION) && !defined(ALLOCATION_TRACKER_DISABLED)
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <execinfo.h>
+#include <unistd.h>
+#endif
+
+static void* trackedAllocate(size_t size)
+{
+    AllocationTracker::Counters& c = AllocationTracker::counters();
+    c.count++;
+    c.bytes += size;
+    if (c.trace) {
+        c.trace = false;
+#if defined(__linux__) || defined(__APPLE__)
+        void* frames[32];
+        int n = backtrace(frames, 32);
+        fprintf(stderr, "allocation of %zu bytes from:\n", size);
+        backtrace_symbols_fd(frames, n, STDERR_FILENO);
+#endif
+    }
+    void* p = malloc(size > 0 ? size : 1);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size)
+{
+    return trackedAllocate(size);
+}
+
+void* operator new[](size_t size)
+{
+    return trackedAllocate(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    try {
+        return trackedAllocate(size);
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    try {
+        return trackedAllocate(size);
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    free(p);
+}
+
+#endif
+
+#endif
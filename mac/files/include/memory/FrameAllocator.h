@@ -0,0 +1,135 @@
+#ifndef FRAME_ALLOCATOR_H
+#define FRAME_ALLOCATOR_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <type_traits>
+
+#include "memory/MemoryTracker.h"
+
+// Fixed-capacity array carved out of a FrameAllocator; gone at the end of
+// the frame, so it is only for trivially destructible types.
+template <typename T>
+struct FrameArray {
+    T* Data = nullptr;
+    size_t Size = 0;
+    size_t Capacity = 0;
+
+    // false, dropping the value, when full
+    bool push_back(const T& value) {
+        if (Size == Capacity)
+            return false;
+        Data[Size++] = value;
+        return true;
+    }
+
+    T& operator[](size_t i) { return Data[i]; }
+    const T& operator[](size_t i) const { return Data[i]; }
+    T* begin() { return Data; }
+    T* end() { return Data + Size; }
+    const T* begin() const { return Data; }
+    const T* end() const { return Data + Size; }
+    bool empty() const { return Size == 0; }
+};
+
+// Per-frame bump allocator for transient data: draw lists, scratch arrays,
+// formatted text. Allocate() moves a pointer through one block reserved up
+// front and Reset(), at the end of the frame, moves it back, so nothing is
+// freed one by one and the frame makes no heap allocations. A frame that
+// needs more than the block gets heap overflow blocks; Reset() frees them
+// and grows the block to the frame's peak, so only that frame pays.
+class FrameAllocator {
+public:
+    FrameAllocator(size_t capacity = 1 << 20) {
+        grow(capacity);
+    }
+
+    ~FrameAllocator() {
+        Reset();
+        free(buffer);
+    }
+
+    FrameAllocator(const FrameAllocator&) = delete;
+    FrameAllocator& operator=(const FrameAllocator&) = delete;
+
+    void* Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+        size_t start = (offset + alignment - 1) & ~(alignment - 1);
+        if (start + bytes <= capacity) {
+            offset = start + bytes;
+            used += bytes;
+            return buffer + start;
+        }
+        // out of room until Reset(); alignment from malloc covers max_align_t
+        void* block = malloc(bytes > 0 ? bytes : 1);
+        overflow.push_back(block);
+        used += bytes;
+        overflowed += bytes;
+        return block;
+    }
+
+    template <typename T>
+    T* Allocate(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "frame memory is never destroyed");
+        return (T*)Allocate(count * sizeof(T), alignof(T));
+    }
+
+    template <typename T>
+    FrameArray<T> Array(size_t capacity) {
+        FrameArray<T> array;
+        array.Data = Allocate<T>(capacity);
+        array.Capacity = capacity;
+        return array;
+    }
+
+    // everything allocated since the last Reset() becomes invalid
+    void Reset() {
+        if (used > peak)
+            peak = used;
+        if (!overflow.empty()) {
+            for (void* block : overflow)
+                free(block);
+            overflow.clear();
+            std::cout << "frame allocator grew to " << peak << " bytes (" << overflowed << " overflowed)" << std::endl;
+            grow(peak + peak / 4);
+        }
+        offset = 0;
+        used = 0;
+        overflowed = 0;
+    }
+
+    size_t Used() const {
+        return used;
+    }
+
+    size_t Capacity() const {
+        return capacity;
+    }
+
+    // most used in one frame
+    size_t Peak() const {
+        return peak > used ? peak : used;
+    }
+
+private:
+    unsigned char* buffer = nullptr;
+    size_t capacity = 0;
+    size_t offset = 0;
+    size_t used = 0;
+    size_t peak = 0;
+    size_t overflowed = 0;
+    std::vector<void*> overflow;
+    MemoryGauge memory { MEMORY_GEOMETRY };
+
+    void grow(size_t size) {
+        free(buffer);
+        buffer = (unsigned char*)malloc(size);
+        capacity = size;
+        overflow.reserve(16);
+        memory.Set((int64_t)size);
+    }
+};
+
+#endif
@@ -0,0 +1,199 @@
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+
+// what a tracked allocation is for
+enum MemoryTag {
+    MEMORY_WORLD,       // blocks and the save's copy of them
+    MEMORY_GEOMETRY,    // CPU-side vertex and index data
+    MEMORY_GPU_BUFFERS, // vertex, index and streaming buffers on the GPU
+    MEMORY_TEXTURES,    // texture images on the GPU
+    MEMORY_IO,          // mapped files and staging or write buffers
+    MEMORY_TAGS
+};
+
+// Tagged memory accounting.
+//
+// Owners report what they hold with Allocate() and Free(), or through a
+// MemoryGauge for containers that grow and shrink; counts are atomic, so any
+// thread may report. Update(), called once per frame on the main thread,
+// checks each tag against its budget: the first frame a tag goes over it is
+// logged, and the tag's evictor, if one is set, is asked to free the excess,
+// least recently used data first. With ReportInterval set, Update() also
+// prints every tag's current and peak size that often.
+class MemoryTracker {
+public:
+    // frees at least the given bytes if it can; returns the bytes freed
+    typedef std::function<size_t(size_t excess)> Evictor;
+
+    // Report options
+    double ReportInterval = 0.0;    // seconds; 0 reports only when asked
+
+    // never destroyed, so globals can still report from their destructors
+    static MemoryTracker& Get() {
+        static MemoryTracker* tracker = new MemoryTracker();
+        return *tracker;
+    }
+
+    static const char* TagName(MemoryTag tag) {
+        static const char* names[MEMORY_TAGS] = { "world", "geometry", "gpu buffers", "textures", "io" };
+        return names[tag];
+    }
+
+    // tag from its name, or MEMORY_TAGS if there is none
+    static MemoryTag TagFromName(const std::string& name) {
+        for (int t = 0; t < MEMORY_TAGS; t++) {
+            std::string tagName = TagName((MemoryTag)t);
+            for (char& c : tagName)
+                c = c == ' ' ? '-' : c;
+            if (name == tagName || name == TagName((MemoryTag)t))
+                return (MemoryTag)t;
+        }
+        return MEMORY_TAGS;
+    }
+
+    void Allocate(MemoryTag tag, int64_t bytes) {
+        Account& a = accounts[tag];
+        int64_t used = a.used.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        int64_t peak = a.peak.load(std::memory_order_relaxed);
+        while (used > peak && !a.peak.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {}
+    }
+
+    void Free(MemoryTag tag, int64_t bytes) {
+        accounts[tag].used.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    int64_t Used(MemoryTag tag) const {
+        return accounts[tag].used.load(std::memory_order_relaxed);
+    }
+
+    int64_t Peak(MemoryTag tag) const {
+        return accounts[tag].peak.load(std::memory_order_relaxed);
+    }
+
+    int64_t Total() const {
+        int64_t total = 0;
+        for (int t = 0; t < MEMORY_TAGS; t++)
+            total += Used((MemoryTag)t);
+        return total;
+    }
+
+    // 0 removes the budget
+    void SetBudget(MemoryTag tag, int64_t bytes) {
+        accounts[tag].budget = bytes;
+        accounts[tag].over = false;
+    }
+
+    int64_t Budget(MemoryTag tag) const {
+        return accounts[tag].budget;
+    }
+
+    // called on the main thread when the tag is over budget
+    void SetEvictor(MemoryTag tag, Evictor evictor) {
+        accounts[tag].evictor = evictor;
+    }
+
+    void Update() {
+        for (int t = 0; t < MEMORY_TAGS; t++) {
+            Account& a = accounts[t];
+            int64_t used = a.used.load(std::memory_order_relaxed);
+            if (a.budget <= 0 || used <= a.budget) {
+                a.over = false;
+                continue;
+            }
+            if (a.evictor) {
+                size_t freed = a.evictor((size_t)(used - a.budget));
+                used -= (int64_t)freed;
+            }
+            if (used > a.budget && !a.over)
+                printf("WARNING::MEMORY::OVER_BUDGET %s %s of %s\n", TagName((MemoryTag)t),
+                       Format(used).c_str(), Format(a.budget).c_str());
+            a.over = used > a.budget;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (ReportInterval > 0.0 && now - lastReport >= std::chrono::duration<double>(ReportInterval)) {
+            Report();
+            lastReport = now;
+        }
+    }
+
+    void Report() const {
+        printf("memory: %s\n", Format(Total()).c_str());
+        for (int t = 0; t < MEMORY_TAGS; t++) {
+            const Account& a = accounts[t];
+            printf("  %-12s %10s  peak %10s", TagName((MemoryTag)t), Format(Used((MemoryTag)t)).c_str(),
+                   Format(Peak((MemoryTag)t)).c_str());
+            if (a.budget > 0)
+                printf("  budget %10s%s", Format(a.budget).c_str(), a.over ? "  OVER" : "");
+            printf("\n");
+        }
+        fflush(stdout);
+    }
+
+    // bytes in the largest unit that keeps them at 1 or more
+    static std::string Format(int64_t bytes) {
+        static const char* units[] = { "B", "KB", "MB", "GB" };
+        double value = (double)bytes;
+        int unit = 0;
+        while (unit < 3 && (value >= 1024.0 || value <= -1024.0)) {
+            value /= 1024.0;
+            unit++;
+        }
+        char text[32];
+        snprintf(text, sizeof(text), unit == 0 ? "%.0f %s" : "%.1f %s", value, units[unit]);
+        return text;
+    }
+
+private:
+    struct Account {
+        std::atomic<int64_t> used { 0 };
+        std::atomic<int64_t> peak { 0 };
+        int64_t budget = 0;
+        bool over = false;
+        Evictor evictor;
+    };
+
+    Account accounts[MEMORY_TAGS];
+    std::chrono::steady_clock::time_point lastReport = std::chrono::steady_clock::now();
+
+    MemoryTracker() {}
+};
+
+// Reports a size that is set rather than allocated, such as a vector's
+// capacity, as the change from the last size; gives it all back when
+// destroyed.
+class MemoryGauge {
+public:
+    MemoryGauge(MemoryTag tag) : tag(tag) {}
+
+    ~MemoryGauge() {
+        Set(0);
+    }
+
+    MemoryGauge(const MemoryGauge&) = delete;
+    MemoryGauge& operator=(const MemoryGauge&) = delete;
+
+    void Set(int64_t bytes) {
+        if (bytes != current)
+            MemoryTracker::Get().Allocate(tag, bytes - current);
+        current = bytes;
+    }
+
+    int64_t Get() const {
+        return current;
+    }
+
+private:
+    MemoryTag tag;
+    int64_t current = 0;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include <glad/glad.h>
+
+struct GLFWwindow;
+
+// Owner of the GL context and of whatever the frames are presented to.
+// Init() creates the context and loads the GL function pointers, leaving it
+// current on the calling thread; MakeCurrent() moves it to another thread.
+// PollEvents() belongs to the thread that called Init().
+class Backend {
+public:
+    virtual ~Backend() {}
+
+    virtual bool Init(int width, int height, const char* title) = 0;
+    virtual void Shutdown() = 0;
+
+    // function loader for GL entry points outside the 3.3 core set
+    virtual GLADloadproc Loader() = 0;
+    // seconds since Init()
+    virtual double Time() = 0;
+
+    // binds the context to the calling thread, or releases it from it
+    virtual void MakeCurrent(bool current) = 0;
+
+    virtual bool ShouldClose() = 0;
+    // called after the frame has been drawn, with the context current
+    virtual void Present() = 0;
+    virtual void PollEvents() = 0;
+
+    // the window receiving input, if there is one
+    virtual GLFWwindow* Window() {
+        return nullptr;
+    }
+};
+
+#endif
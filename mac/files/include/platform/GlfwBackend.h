@@ -0,0 +1,78 @@
+#ifndef GLFW_BACKEND_H
+#define GLFW_BACKEND_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <iostream>
+
+#include "platform/Backend.h"
+
+// on-screen rendering into a GLFW window
+class GlfwBackend : public Backend {
+public:
+    bool Init(int width, int height, const char* title) override {
+        // initialize glfw
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+
+        // use glfw to create window
+        window = glfwCreateWindow(width, height, title, NULL, NULL);
+        if (window == NULL)
+        {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return false;
+        }
+        glfwMakeContextCurrent(window);
+
+        // use glad to load opengl pointers
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+        {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void Shutdown() override {
+        glfwTerminate();
+        window = NULL;
+    }
+
+    GLADloadproc Loader() override {
+        return (GLADloadproc)glfwGetProcAddress;
+    }
+
+    double Time() override {
+        return glfwGetTime();
+    }
+
+    void MakeCurrent(bool current) override {
+        glfwMakeContextCurrent(current ? window : NULL);
+    }
+
+    bool ShouldClose() override {
+        return glfwWindowShouldClose(window);
+    }
+
+    void Present() override {
+        glfwSwapBuffers(window);
+    }
+
+    void PollEvents() override {
+        glfwPollEvents();
+    }
+
+    GLFWwindow* Window() override {
+        return window;
+    }
+
+private:
+    GLFWwindow* window = NULL;
+};
+
+#endif
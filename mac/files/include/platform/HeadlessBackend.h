@@ -0,0 +1,167 @@
+#ifndef HEADLESS_BACKEND_H
+#define HEADLESS_BACKEND_H
+
+// Offscreen rendering without a display: an EGL context on Mesa's
+// surfaceless platform (llvmpipe when there is no GPU) drawing into a
+// framebuffer object. It runs a fixed number of frames, and can write every
+// Nth frame to a PNG. Only available where EGL is (Linux).
+
+#if defined(__linux__)
+#define HEADLESS_BACKEND_AVAILABLE 1
+
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <iostream>
+
+#include "platform/Backend.h"
+#include "image/PngWriter.h"
+
+class HeadlessBackend : public Backend {
+public:
+    // Run options
+    int Frames;
+    int CaptureEvery;           // 0 = no captures
+    std::string CaptureDirectory;
+
+    HeadlessBackend(int frames, int captureEvery = 0, const std::string& captureDirectory = ".") : Frames(frames), CaptureEvery(captureEvery), CaptureDirectory(captureDirectory) {}
+
+    bool Init(int width, int height, const char* /* title: no window */) override {
+        this->width = width;
+        this->height = height;
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay != nullptr)
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if (display == EGL_NO_DISPLAY)
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+        {
+            std::cout << "Failed to initialize EGL" << std::endl;
+            return false;
+        }
+        eglBindAPI(EGL_OPENGL_API);
+
+        EGLint configAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+        EGLConfig config = NULL;
+        EGLint count = 0;
+        eglChooseConfig(display, configAttribs, &config, 1, &count);
+        EGLint contextAttribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        // no surface is ever created, so any config (or none) will do
+        context = eglCreateContext(display, count > 0 ? config : (EGLConfig)0, EGL_NO_CONTEXT, contextAttribs);
+        if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+        {
+            std::cout << "Failed to create headless GL context" << std::endl;
+            return false;
+        }
+
+        // use glad to load opengl pointers
+        if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+        {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return false;
+        }
+        std::cout << "headless renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+        // render target standing in for the window's default framebuffer
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glGenRenderbuffers(2, renderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_SRGB8_ALPHA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "Failed to create headless framebuffer" << std::endl;
+            return false;
+        }
+        glViewport(0, 0, width, height);
+        start = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    void Shutdown() override {
+        if (display == EGL_NO_DISPLAY)
+            return;
+        if (fbo != 0)
+        {
+            glDeleteFramebuffers(1, &fbo);
+            glDeleteRenderbuffers(2, renderbuffers);
+            fbo = 0;
+        }
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (context != EGL_NO_CONTEXT)
+            eglDestroyContext(display, context);
+        eglTerminate(display);
+        display = EGL_NO_DISPLAY;
+        context = EGL_NO_CONTEXT;
+    }
+
+    GLADloadproc Loader() override {
+        return (GLADloadproc)eglGetProcAddress;
+    }
+
+    double Time() override {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void MakeCurrent(bool current) override {
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, current ? context : EGL_NO_CONTEXT);
+    }
+
+    bool ShouldClose() override {
+        return frame >= Frames;
+    }
+
+    // there is no swap to wait on, so finish the frame to keep its GPU time
+    // inside the frame it belongs to
+    void Present() override {
+        glFinish();
+        if (CaptureEvery > 0 && frame % CaptureEvery == 0)
+            Capture(CaptureDirectory + "/frame_" + std::to_string(frame) + ".png");
+        frame++;
+    }
+
+    void PollEvents() override {}
+
+    int FrameIndex() const {
+        return frame;
+    }
+
+    // writes what has been drawn to path as a PNG
+    bool Capture(const std::string& path) {
+        std::vector<unsigned char> pixels((size_t)width * height * 4);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        bool written = writePng(path, width, height, pixels.data(), true);
+        if (!written)
+            std::cout << "ERROR::HEADLESS::CAPTURE_NOT_WRITTEN " << path << std::endl;
+        return written;
+    }
+
+private:
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+    unsigned int fbo = 0;
+    unsigned int renderbuffers[2] = { 0, 0 };
+    int width = 0, height = 0;
+    std::atomic<int> frame { 0 };    // counted by Present(), read by ShouldClose()
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif
+
+#endif
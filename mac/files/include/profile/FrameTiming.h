@@ -0,0 +1,183 @@
+#ifndef FRAME_TIMING_H
+#define FRAME_TIMING_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+
+#include "log/Logger.h"
+
+// Latency histogram in the style of HdrHistogram: values (microseconds) fall
+// into buckets spaced linearly within each power of two, 64 per power, so
+// any percentile is within 1.6% of the true value whatever the range, in a
+// fixed few KB.
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 6;
+    static const uint64_t SUB_COUNT = 1 << SUB_BITS;
+
+    LatencyHistogram() : counts(SUB_COUNT * 40, 0) {}
+
+    void Record(uint64_t us) {
+        size_t i = index(us);
+        if (i >= counts.size())
+            i = counts.size() - 1;
+        counts[i]++;
+        count++;
+        if (us > max)
+            max = us;
+    }
+
+    // smallest value that p percent of recorded values are at or below,
+    // rounded up to the top of its bucket
+    uint64_t Percentile(double p) const {
+        if (count == 0)
+            return 0;
+        uint64_t target = (uint64_t)(p / 100.0 * count + 0.5);
+        target = target < 1 ? 1 : target;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            if (seen >= target)
+                return highest(i) < max ? highest(i) : max;
+        }
+        return max;
+    }
+
+    uint64_t Max() const {
+        return max;
+    }
+
+    uint64_t Count() const {
+        return count;
+    }
+
+    void Reset() {
+        std::fill(counts.begin(), counts.end(), 0);
+        count = 0;
+        max = 0;
+    }
+
+private:
+    std::vector<uint32_t> counts;
+    uint64_t count = 0;
+    uint64_t max = 0;
+
+    static size_t index(uint64_t v) {
+        if (v < SUB_COUNT)
+            return (size_t)v;
+        int shift = 63 - __builtin_clzll(v) - SUB_BITS;
+        return (size_t)((shift + 1) * SUB_COUNT + ((v >> shift) - SUB_COUNT));
+    }
+
+    static uint64_t highest(size_t i) {
+        if (i < SUB_COUNT)
+            return i;
+        int shift = (int)(i / SUB_COUNT) - 1;
+        uint64_t m = i % SUB_COUNT + SUB_COUNT;
+        return ((m + 1) << shift) - 1;
+    }
+};
+
+// Frame-time tracking for the render loop. Each frame is split into
+// simulation (input and physics, or waiting for them when they run on
+// another thread), render (building and submitting draws) and present.
+// Every phase goes into a histogram for the whole run and one for the
+// current report window; EndFrame() prints the window's percentiles every
+// ReportInterval seconds, and a frame over BudgetMs is logged with its
+// breakdown as it happens, through the logger so the render thread never
+// waits on stdout.
+class FrameTiming {
+public:
+    // Timing options
+    double BudgetMs;
+    double ReportInterval;
+
+    FrameTiming(double budgetMs = 50.0, double reportInterval = 5.0) : BudgetMs(budgetMs), ReportInterval(reportInterval) {
+        lastReport = std::chrono::steady_clock::now();
+    }
+
+    void BeginFrame() {
+        begin = std::chrono::steady_clock::now();
+        simulationEnd = renderEnd = begin;
+    }
+
+    void EndSimulation() {
+        simulationEnd = std::chrono::steady_clock::now();
+    }
+
+    void EndRender() {
+        renderEnd = std::chrono::steady_clock::now();
+    }
+
+    void EndFrame() {
+        auto end = std::chrono::steady_clock::now();
+        uint64_t phases[PHASES] = {
+            micros(end - begin),
+            micros(simulationEnd - begin),
+            micros(renderEnd - simulationEnd),
+            micros(end - renderEnd),
+        };
+        for (int p = 0; p < PHASES; p++) {
+            run[p].Record(phases[p]);
+            window[p].Record(phases[p]);
+        }
+        if (phases[TOTAL] > BudgetMs * 1000.0) {
+            overBudget++;
+            windowOverBudget++;
+            LOG_WARNING("frame {} over budget: {} ms (simulation {}, render {}, present {})",
+                        frame, phases[TOTAL] / 1000.0, phases[SIMULATION] / 1000.0,
+                        phases[RENDER] / 1000.0, phases[PRESENT] / 1000.0);
+        }
+        frame++;
+
+        if (end - lastReport >= std::chrono::duration<double>(ReportInterval)) {
+            report("last " + std::to_string((int)ReportInterval) + "s", window, windowOverBudget);
+            for (LatencyHistogram& h : window)
+                h.Reset();
+            windowOverBudget = 0;
+            lastReport = end;
+        }
+    }
+
+    // percentiles over every frame so far
+    void Report() const {
+        report("run", run, overBudget);
+    }
+
+    const LatencyHistogram& Total() const {
+        return run[TOTAL];
+    }
+
+private:
+    enum Phase { TOTAL, SIMULATION, RENDER, PRESENT, PHASES };
+
+    LatencyHistogram run[PHASES];
+    LatencyHistogram window[PHASES];
+    std::chrono::steady_clock::time_point begin, simulationEnd, renderEnd, lastReport;
+    uint64_t frame = 0;
+    uint64_t overBudget = 0, windowOverBudget = 0;
+
+    static uint64_t micros(std::chrono::steady_clock::duration d) {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    }
+
+    void report(const std::string& label, const LatencyHistogram* h, uint64_t over) const {
+        static const char* names[PHASES] = { "total", "simulation", "render", "present" };
+        if (h[TOTAL].Count() == 0)
+            return;
+        printf("frame times (%s, %llu frames, %llu over %.1f ms budget):\n", label.c_str(),
+               (unsigned long long)h[TOTAL].Count(), (unsigned long long)over, BudgetMs);
+        for (int p = 0; p < PHASES; p++) {
+            printf("  %-10s p50 %7.2f  p95 %7.2f  p99 %7.2f  max %7.2f ms\n", names[p],
+                   h[p].Percentile(50) / 1000.0, h[p].Percentile(95) / 1000.0,
+                   h[p].Percentile(99) / 1000.0, h[p].Max() / 1000.0);
+        }
+        fflush(stdout);
+    }
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef INPUT_LATENCY_H
+#define INPUT_LATENCY_H
+
+#include <cstdio>
+#include <cstdint>
+
+#include "profile/FrameTiming.h"
+
+// Input-to-present latency: for each presented frame that shows input newer
+// than the frames before it, the time from that input arriving to the end of
+// the present. Times are seconds on the backend's clock.
+class InputLatency {
+public:
+    void Presented(double inputTime, double presentTime) {
+        if (inputTime <= 0.0 || inputTime <= lastInput)
+            return;
+        lastInput = inputTime;
+        double latency = presentTime - inputTime;
+        histogram.Record((uint64_t)(latency > 0.0 ? latency * 1e6 : 0.0));
+    }
+
+    void Report(const char* label) const {
+        if (histogram.Count() == 0)
+            return;
+        printf("input to present (%s, %llu frames): p50 %.2f  p95 %.2f  p99 %.2f  max %.2f ms\n", label,
+               (unsigned long long)histogram.Count(), histogram.Percentile(50) / 1000.0,
+               histogram.Percentile(95) / 1000.0, histogram.Percentile(99) / 1000.0, histogram.Max() / 1000.0);
+        fflush(stdout);
+    }
+
+    const LatencyHistogram& Histogram() const {
+        return histogram;
+    }
+
+private:
+    LatencyHistogram histogram;
+    double lastInput = 0.0;
+};
+
+#endif
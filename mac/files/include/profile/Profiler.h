@@ -0,0 +1,297 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+
+// Hierarchical frame profiler.
+//
+// PROFILE_SCOPE("name") times the enclosing scope on the calling thread and
+// PROFILE_GPU_SCOPE("name") brackets the GL work issued in it with timestamp
+// queries. Each thread appends to its own ring buffer, so recording takes no
+// lock; WriteTrace() turns the most recent events of every thread, plus the
+// GPU, into one Chrome trace (chrome://tracing, ui.perfetto.dev). Scopes cost
+// an atomic load while the profiler is off, and nothing at all when built
+// with PROFILER_DISABLED. Names must be string literals.
+
+#ifndef GL_TIMESTAMP
+#define GL_TIMESTAMP 0x8E28
+#endif
+
+struct ProfileEvent {
+    const char* name;
+    int64_t start, end;     // ns since the profiler started
+};
+
+// events recorded by one thread, written only by that thread. Another
+// thread reads them with snapshot(), which pauses the ring while it copies:
+// events recorded meanwhile are dropped, and a record() already under way
+// is waited out. busy and paused are sequentially consistent, so either
+// record() sees the pause or snapshot() sees the record.
+struct ProfileThread {
+    static const size_t CAPACITY = 1 << 16;
+
+    std::string name;
+    uint32_t id;
+    std::vector<ProfileEvent> events;
+    std::atomic<uint64_t> count { 0 };
+    std::atomic<bool> busy { false };
+    std::atomic<bool> paused { false };
+
+    ProfileThread(uint32_t id) : id(id), events(CAPACITY) {}
+
+    void record(const char* name, int64_t start, int64_t end) {
+        busy.store(true);
+        if (!paused.load()) {
+            uint64_t i = count.load(std::memory_order_relaxed);
+            events[i & (CAPACITY - 1)] = { name, start, end };
+            count.store(i + 1, std::memory_order_relaxed);
+        }
+        busy.store(false, std::memory_order_release);
+    }
+
+    // the buffered events, oldest first
+    void snapshot(std::vector<ProfileEvent>& out) {
+        paused.store(true);
+        while (busy.load())
+            std::this_thread::yield();
+        uint64_t n = count.load(std::memory_order_relaxed);
+        out.clear();
+        for (uint64_t i = n > CAPACITY ? n - CAPACITY : 0; i < n; i++)
+            out.push_back(events[i & (CAPACITY - 1)]);
+        paused.store(false, std::memory_order_release);
+    }
+};
+
+class Profiler {
+public:
+    std::atomic<bool> Enabled { false };
+
+    static Profiler& Get() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    int64_t Now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void Record(const char* name, int64_t begin, int64_t end) {
+        thread().record(name, begin, end);
+    }
+
+    // label the calling thread in the trace; a thread's buffer is only
+    // allocated once it records something
+    void SetThreadName(const std::string& name) {
+        if (current() == nullptr) {
+            threadName() = name;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        current()->name = name;
+    }
+
+    // GPU timing; needs a current context, and Begin/EndGpu and EndFrame
+    // must all be called on the GL thread
+    void InitGpu() {
+        gpu.reset(new ProfileThread(GPU_THREAD_ID));
+        gpu->name = "GPU";
+        calibrate();
+    }
+
+    int BeginGpu() {
+        if (!gpu)
+            return -1;
+        GpuScope scope;
+        scope.begin = query();
+        scope.end = 0;
+        glQueryCounter(scope.begin, GL_TIMESTAMP);
+        gpuScopes.push_back(scope);
+        return (int)(gpuScopes.size() - 1);
+    }
+
+    void EndGpu(int scope, const char* name) {
+        if (scope < 0)
+            return;
+        GpuScope& s = gpuScopes[scope];
+        s.name = name;
+        s.end = query();
+        glQueryCounter(s.end, GL_TIMESTAMP);
+    }
+
+    // collect GPU timings that have become available, without waiting
+    void EndFrame() {
+        if (!gpu)
+            return;
+        while (gpuHead < gpuScopes.size() && gpuScopes[gpuHead].end != 0) {
+            GpuScope& s = gpuScopes[gpuHead];
+            GLint available = 0;
+            glGetQueryObjectiv(s.end, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(s.begin, GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(s.end, GL_QUERY_RESULT, &end);
+            gpu->record(s.name, (int64_t)begin + gpuOffset, (int64_t)end + gpuOffset);
+            freeQueries.push_back(s.begin);
+            freeQueries.push_back(s.end);
+            gpuHead++;
+        }
+        // no scope is open between frames, so the finished ones can be
+        // dropped from the front; the storage is kept for the next frames
+        if (gpuHead > 0 && gpuHead * 2 >= gpuScopes.size()) {
+            gpuScopes.erase(gpuScopes.begin(), gpuScopes.begin() + gpuHead);
+            gpuHead = 0;
+        }
+        // the GPU clock drifts against the CPU one
+        if (Now() - calibrated > 1000000000)
+            calibrate();
+    }
+
+    // every thread's buffered events as a Chrome trace; safe while other
+    // threads keep recording
+    bool WriteTrace(const std::string& path) {
+        FILE* f = fopen(path.c_str(), "w");
+        if (f == NULL) {
+            std::cout << "ERROR::PROFILER::TRACE_NOT_WRITTEN " << path << std::endl;
+            return false;
+        }
+        size_t written = 0;
+        fprintf(f, "{\"traceEvents\":[\n");
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<ProfileThread*> all;
+        for (auto& t : threads)
+            all.push_back(t.get());
+        if (gpu)
+            all.push_back(gpu.get());
+        bool first = true;
+        for (ProfileThread* t : all) {
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                    first ? "" : ",\n", t->id, t->name.empty() ? "thread" : t->name.c_str());
+            first = false;
+            t->snapshot(snapshot);
+            for (const ProfileEvent& e : snapshot) {
+                fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                        e.name, t->id, e.start / 1000.0, (e.end - e.start) / 1000.0);
+                written++;
+            }
+        }
+        fprintf(f, "\n]}\n");
+        bool ok = ferror(f) == 0;
+        fclose(f);
+        std::cout << "wrote " << written << " profile events to " << path << std::endl;
+        return ok;
+    }
+
+private:
+    static const uint32_t GPU_THREAD_ID = 1000;
+
+    struct GpuScope {
+        const char* name = "";
+        GLuint begin, end;
+    };
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ProfileThread>> threads;
+    std::vector<ProfileEvent> snapshot;     // WriteTrace()'s copy of one ring
+
+    std::unique_ptr<ProfileThread> gpu;
+    std::vector<GpuScope> gpuScopes;   // waiting for results from gpuHead on
+    size_t gpuHead = 0;
+    std::vector<GLuint> freeQueries;
+    int64_t gpuOffset = 0;      // add to a GPU timestamp to get profiler time
+    int64_t calibrated = 0;
+
+    static ProfileThread*& current() {
+        thread_local ProfileThread* thread = nullptr;
+        return thread;
+    }
+
+    static std::string& threadName() {
+        thread_local std::string name;
+        return name;
+    }
+
+    ProfileThread& thread() {
+        if (current() == nullptr) {
+            std::lock_guard<std::mutex> lock(mutex);
+            threads.emplace_back(new ProfileThread((uint32_t)threads.size() + 1));
+            current() = threads.back().get();
+            current()->name = threadName();
+        }
+        return *current();
+    }
+
+    GLuint query() {
+        GLuint q;
+        if (freeQueries.empty()) {
+            glGenQueries(1, &q);
+        }
+        else {
+            q = freeQueries.back();
+            freeQueries.pop_back();
+        }
+        return q;
+    }
+
+    void calibrate() {
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        calibrated = Now();
+        gpuOffset = calibrated - gpuNow;
+    }
+};
+
+class ProfileScope {
+public:
+    ProfileScope(const char* name) : name(Profiler::Get().Enabled.load(std::memory_order_relaxed) ? name : nullptr) {
+        if (this->name != nullptr)
+            begin = Profiler::Get().Now();
+    }
+
+    ~ProfileScope() {
+        if (name != nullptr)
+            Profiler::Get().Record(name, begin, Profiler::Get().Now());
+    }
+
+private:
+    const char* name;
+    int64_t begin = 0;
+};
+
+class GpuProfileScope {
+public:
+    GpuProfileScope(const char* name) : name(name), scope(Profiler::Get().Enabled.load(std::memory_order_relaxed) ? Profiler::Get().BeginGpu() : -1) {}
+
+    ~GpuProfileScope() {
+        Profiler::Get().EndGpu(scope, name);
+    }
+
+private:
+    const char* name;
+    int scope;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#ifdef PROFILER_DISABLED
+#define PROFILE_SCOPE(name)
+#define PROFILE_GPU_SCOPE(name)
+#else
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
+#endif
+
+#endif
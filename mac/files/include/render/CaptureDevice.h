@@ -0,0 +1,679 @@
+#ifndef CAPTURE_DEVICE_H
+#define CAPTURE_DEVICE_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <set>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+#include "render/Device.h"
+#include "shader/ProgramSources.h"
+
+// Capture file, replayed by tools/replay_capture.
+//
+// Layout: a CaptureHeader, then the resources the captured frames use, then
+// the command stream. Each resource starts with a CaptureResource record and
+// is read back from GL the first time a captured command uses it, so it holds
+// what the captured frames started from. Buffer and texture uploads made
+// through the device after that are ops in the command stream, carrying their
+// bytes; uploads made straight to GL during a capture are missed. Commands
+// are a one-byte CaptureOp followed by that op's arguments; every frame ends
+// in FRAME_END.
+
+const uint32_t CAPTURE_MAGIC = 0x5043474f; // "OGCP"
+const uint32_t CAPTURE_VERSION = 4;
+
+struct CaptureHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;         // viewport
+    uint32_t height;
+    uint32_t frames;
+    uint32_t resources;
+    uint64_t commandBytes;
+};
+
+enum CaptureResourceKind : uint32_t {
+    CAPTURE_STATE = 1,      // size bytes of CaptureState
+    CAPTURE_PROGRAM,        // CaptureProgram, then its binary, sources and CaptureBindings
+    CAPTURE_BUFFER,         // buffer contents, empty if its first use replaced them
+    CAPTURE_VERTEX_ARRAY,   // element buffer (uint32), then CaptureAttribs
+    CAPTURE_TEXTURE,        // CaptureTexture, then its CaptureLevels each followed by data
+};
+
+struct CaptureResource {
+    uint32_t kind;
+    uint32_t id;            // name at capture time, used by the commands
+    uint64_t size;          // bytes that follow
+};
+
+struct CaptureState {
+    uint8_t depthTest, blend, framebufferSrgb, cullFace;
+    uint32_t blendSrc, blendDst;
+    uint32_t depthFunc;
+    float clearDepth;
+};
+
+// Programs are rebuilt from source, with the attribute and fragment output
+// locations they had bound, and uniform locations are translated by name.
+// The binary, when the driver gave one, is only a faster path for a replay
+// on the same driver.
+struct CaptureProgram {
+    uint32_t binaryFormat;
+    uint32_t binaryBytes;   // 0 without a binary
+    uint32_t vertexBytes, fragmentBytes, geometryBytes;     // GLSL; all 0 without sources
+    uint32_t attributes, outputs, uniforms;                 // CaptureBindings, in that order
+};
+
+// a name (nameBytes, not terminated) follows
+struct CaptureBinding {
+    int32_t location;
+    uint32_t nameBytes;
+};
+
+struct CaptureAttrib {
+    uint32_t index;
+    uint32_t buffer;
+    int32_t size;
+    uint32_t type;
+    int32_t normalized;
+    int32_t integer;        // set with glVertexAttribIPointer
+    int32_t stride;
+    uint64_t offset;
+};
+
+struct CaptureTexture {
+    uint32_t target;
+    uint32_t levels;
+    int32_t minFilter, magFilter, wrapS, wrapT;
+};
+
+struct CaptureLevel {
+    uint32_t internalFormat;
+    uint32_t width, height, depth;
+    uint32_t compressed;    // data is the compressed image, otherwise RGBA of type
+    uint32_t type;          // GL_FLOAT for float formats, otherwise GL_UNSIGNED_BYTE
+    uint32_t bytes;
+};
+
+enum CaptureOp : uint8_t {
+    OP_CLEAR = 1,           // 4 floats, uint32 mask
+    OP_USE_PROGRAM,         // uint32
+    OP_BIND_VERTEX_ARRAY,   // uint32
+    OP_BIND_TEXTURE,        // uint32 target, uint32 texture
+    OP_UNIFORM_INTS,        // int32 location, uint8 components, ints
+    OP_UNIFORM_FLOATS,      // int32 location, uint8 components, floats
+    OP_UNIFORM_MATRIX,      // int32 location, uint8 size, size * size floats
+    OP_DRAW_ELEMENTS,       // uint32 mode, int32 count, uint32 type, uint64 offset
+    OP_FRAME_END,
+    OP_DRAW_ARRAYS,         // uint32 mode, int32 first, int32 count
+    OP_ACTIVE_TEXTURE,      // uint32 unit
+    OP_BUFFER_DATA,         // uint32 buffer, uint64 size, uint32 usage, uint8 has data, size bytes if it has
+    OP_BUFFER_SUB_DATA,     // uint32 buffer, uint64 offset, uint64 size, size bytes
+    OP_TEX_SUB_IMAGE,       // CaptureTexImage, then its bytes
+};
+
+struct CaptureTexImage {
+    uint32_t target;
+    uint32_t texture;
+    int32_t level;
+    int32_t x, y, z;
+    int32_t width, height, depth;
+    uint32_t format, type;
+    int32_t alignment;      // GL_UNPACK_ALIGNMENT the rows are padded to
+    uint64_t bytes;
+};
+
+// the loader only covers GL 3.3 core; see shader/ShaderCache.h
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+
+// Records every call into the capture format and passes it on to the device
+// it wraps. Call Begin() to capture the next frames and EndFrame() after each
+// frame; the file is written when the last one ends. Resources are read back
+// as they are first used, so recording stalls on those frames.
+class CaptureDevice : public Device {
+public:
+    CaptureDevice(Device& target) : target(target) {}
+
+    // needs a current context, for reading back programs
+    void Init(GLADloadproc load) {
+        getProgramBinary = (GetProgramBinaryFn)load("glGetProgramBinary");
+    }
+
+    // needs a current context; the GL state is read back here
+    void Begin(const std::string& path, int frames) {
+        this->path = path;
+        framesLeft = frames;
+        framesCaptured = 0;
+        commands.clear();
+        resources.clear();
+        resourceCount = 0;
+        programs.clear();
+        vertexArrays.clear();
+        buffers.clear();
+        textures.clear();
+        readState();
+    }
+
+    bool Recording() const {
+        return framesLeft > 0;
+    }
+
+    void EndFrame() {
+        if (!Recording())
+            return;
+        put<uint8_t>(OP_FRAME_END);
+        framesCaptured++;
+        if (--framesLeft == 0)
+            write();
+    }
+
+protected:
+    void doClear(float r, float g, float b, float a, GLbitfield mask) override {
+        if (Recording()) {
+            put<uint8_t>(OP_CLEAR);
+            put(r); put(g); put(b); put(a);
+            put<uint32_t>(mask);
+        }
+        target.Clear(r, g, b, a, mask);
+    }
+
+    void doUseProgram(unsigned int program) override {
+        if (Recording() && useProgram(program)) {
+            put<uint8_t>(OP_USE_PROGRAM);
+            put<uint32_t>(program);
+        }
+        target.UseProgram(program);
+    }
+
+    void doBindVertexArray(unsigned int vao) override {
+        if (Recording()) {
+            useVertexArray(vao);
+            put<uint8_t>(OP_BIND_VERTEX_ARRAY);
+            put<uint32_t>(vao);
+        }
+        target.BindVertexArray(vao);
+    }
+
+    void doBindTexture(GLenum textureTarget, unsigned int texture) override {
+        if (Recording()) {
+            useTexture(textureTarget, texture);
+            put<uint8_t>(OP_BIND_TEXTURE);
+            put<uint32_t>(textureTarget);
+            put<uint32_t>(texture);
+        }
+        target.BindTexture(textureTarget, texture);
+    }
+
+    void doActiveTexture(GLenum unit) override {
+        if (Recording()) {
+            put<uint8_t>(OP_ACTIVE_TEXTURE);
+            put<uint32_t>(unit);
+        }
+        target.ActiveTexture(unit);
+    }
+
+    // each program's uniform locations are stored with it, so a replay can
+    // translate the recorded ones and the lookups themselves are not recorded
+    int doUniformLocation(unsigned int program, const char* name) override {
+        return target.UniformLocation(program, name);
+    }
+
+    void doUniformInts(int location, int components, const int* values) override {
+        if (Recording())
+            putUniform(OP_UNIFORM_INTS, location, components, values, components * sizeof(int));
+        target.UniformInts(location, components, values);
+    }
+
+    void doUniformFloats(int location, int components, const float* values) override {
+        if (Recording())
+            putUniform(OP_UNIFORM_FLOATS, location, components, values, components * sizeof(float));
+        target.UniformFloats(location, components, values);
+    }
+
+    void doUniformMatrix(int location, int size, const float* values) override {
+        if (Recording())
+            putUniform(OP_UNIFORM_MATRIX, location, size, values, size * size * sizeof(float));
+        target.UniformMatrix(location, size, values);
+    }
+
+    void doDrawElements(GLenum mode, int count, GLenum type, size_t offset) override {
+        if (Recording()) {
+            put<uint8_t>(OP_DRAW_ELEMENTS);
+            put<uint32_t>(mode);
+            put<int32_t>(count);
+            put<uint32_t>(type);
+            put<uint64_t>(offset);
+        }
+        target.DrawElements(mode, count, type, offset);
+    }
+
+    void doDrawArrays(GLenum mode, int first, int count) override {
+        if (Recording()) {
+            put<uint8_t>(OP_DRAW_ARRAYS);
+            put<uint32_t>(mode);
+            put<int32_t>(first);
+            put<int32_t>(count);
+        }
+        target.DrawArrays(mode, first, count);
+    }
+
+    // recorded against the buffer bound to bufferTarget, which a replay binds
+    // itself; one first seen here needs no contents read back
+    void doBufferData(GLenum bufferTarget, size_t size, const void* data, GLenum usage) override {
+        if (Recording()) {
+            unsigned int buffer = bound(bufferBinding(bufferTarget));
+            if (buffers.insert(buffer).second)
+                addResource(CAPTURE_BUFFER, buffer, std::vector<unsigned char>());
+            put<uint8_t>(OP_BUFFER_DATA);
+            put<uint32_t>(buffer);
+            put<uint64_t>(size);
+            put<uint32_t>(usage);
+            put<uint8_t>(data != nullptr);
+            if (data != nullptr)
+                append(commands, data, size);
+        }
+        target.BufferData(bufferTarget, size, data, usage);
+    }
+
+    void doBufferSubData(GLenum bufferTarget, size_t offset, size_t size, const void* data) override {
+        if (Recording()) {
+            unsigned int buffer = bound(bufferBinding(bufferTarget));
+            useBuffer(buffer);
+            put<uint8_t>(OP_BUFFER_SUB_DATA);
+            put<uint32_t>(buffer);
+            put<uint64_t>(offset);
+            put<uint64_t>(size);
+            append(commands, data, size);
+        }
+        target.BufferSubData(bufferTarget, offset, size, data);
+    }
+
+    void doTexSubImage3D(GLenum textureTarget, int level, int x, int y, int z, int width, int height, int depth,
+                         GLenum format, GLenum type, const void* data) override {
+        if (Recording()) {
+            unsigned int texture = bound(textureBinding(textureTarget));
+            useTexture(textureTarget, texture);
+            GLint alignment = 4;
+            glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+            size_t row = ((size_t)width * TexelBytes(format, type) + alignment - 1) / alignment * alignment;
+            CaptureTexImage image = { textureTarget, texture, level, x, y, z, width, height, depth,
+                                      format, type, alignment, row * height * depth };
+            put<uint8_t>(OP_TEX_SUB_IMAGE);
+            append(commands, &image, sizeof(image));
+            append(commands, data, image.bytes);
+        }
+        target.TexSubImage3D(textureTarget, level, x, y, z, width, height, depth, format, type, data);
+    }
+
+private:
+    typedef void (APIENTRYP GetProgramBinaryFn)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+
+    Device& target;
+    GetProgramBinaryFn getProgramBinary = nullptr;
+    std::string path;
+    int framesLeft = 0;
+    int framesCaptured = 0;
+    std::vector<unsigned char> commands;
+    std::vector<unsigned char> resources;
+    uint32_t resourceCount = 0;
+    std::set<unsigned int> programs;        // already in resources
+    std::set<unsigned int> vertexArrays;
+    std::set<unsigned int> buffers;
+    std::set<unsigned int> textures;
+
+    template <typename T>
+    void put(T value) {
+        append(commands, &value, sizeof(T));
+    }
+
+    void putUniform(CaptureOp op, int location, int components, const void* values, size_t bytes) {
+        put<uint8_t>(op);
+        put<int32_t>(location);
+        put<uint8_t>((uint8_t)components);
+        append(commands, values, bytes);
+    }
+
+    static void append(std::vector<unsigned char>& out, const void* data, size_t bytes) {
+        out.insert(out.end(), (const unsigned char*)data, (const unsigned char*)data + bytes);
+    }
+
+    void addResource(uint32_t kind, uint32_t id, const std::vector<unsigned char>& payload) {
+        CaptureResource resource = { kind, id, payload.size() };
+        append(resources, &resource, sizeof(resource));
+        append(resources, payload.data(), payload.size());
+        resourceCount++;
+    }
+
+    static unsigned int bound(GLenum binding) {
+        GLint name = 0;
+        glGetIntegerv(binding, &name);
+        return (unsigned int)name;
+    }
+
+    static GLenum bufferBinding(GLenum bufferTarget) {
+        switch (bufferTarget) {
+            case GL_ELEMENT_ARRAY_BUFFER: return GL_ELEMENT_ARRAY_BUFFER_BINDING;
+            case GL_UNIFORM_BUFFER: return GL_UNIFORM_BUFFER_BINDING;
+            case GL_PIXEL_UNPACK_BUFFER: return GL_PIXEL_UNPACK_BUFFER_BINDING;
+            case GL_COPY_WRITE_BUFFER: return GL_COPY_WRITE_BUFFER;
+            default: return GL_ARRAY_BUFFER_BINDING;
+        }
+    }
+
+    static GLenum textureBinding(GLenum textureTarget) {
+        switch (textureTarget) {
+            case GL_TEXTURE_3D: return GL_TEXTURE_BINDING_3D;
+            case GL_TEXTURE_2D: return GL_TEXTURE_BINDING_2D;
+            default: return GL_TEXTURE_BINDING_2D_ARRAY;
+        }
+    }
+
+    // the first use of each resource reads it back, before the command that
+    // uses it changes anything
+    bool useProgram(unsigned int program) {
+        if (program == 0 || !programs.insert(program).second)
+            return true;
+        std::vector<unsigned char> payload;
+        // a replay could not draw anything that used it
+        if (!readProgram(program, payload)) {
+            std::cout << "ERROR::CAPTURE::PROGRAM_NOT_RETRIEVABLE " << program << std::endl;
+            framesLeft = 0;
+            finish(false);
+            return false;
+        }
+        addResource(CAPTURE_PROGRAM, program, payload);
+        return true;
+    }
+
+    // along with the buffers it reads, which must come first in the file
+    void useVertexArray(unsigned int vao) {
+        if (vao == 0 || !vertexArrays.insert(vao).second)
+            return;
+        std::vector<unsigned char> payload;
+        std::set<unsigned int> used;
+        readVertexArray(vao, payload, used);
+        for (unsigned int buffer : used)
+            useBuffer(buffer);
+        addResource(CAPTURE_VERTEX_ARRAY, vao, payload);
+    }
+
+    void useBuffer(unsigned int buffer) {
+        if (buffer == 0 || !buffers.insert(buffer).second)
+            return;
+        std::vector<unsigned char> payload;
+        readBuffer(buffer, payload);
+        addResource(CAPTURE_BUFFER, buffer, payload);
+    }
+
+    // leaves texture bound to textureTarget on the active unit
+    void useTexture(GLenum textureTarget, unsigned int texture) {
+        if (texture == 0 || !textures.insert(texture).second)
+            return;
+        std::vector<unsigned char> payload;
+        readTexture(texture, textureTarget, payload);
+        addResource(CAPTURE_TEXTURE, texture, payload);
+    }
+
+    void readState() {
+        CaptureState state = {};
+        state.depthTest = glIsEnabled(GL_DEPTH_TEST);
+        state.blend = glIsEnabled(GL_BLEND);
+        state.framebufferSrgb = glIsEnabled(GL_FRAMEBUFFER_SRGB);
+        state.cullFace = glIsEnabled(GL_CULL_FACE);
+        GLint value;
+        glGetIntegerv(GL_BLEND_SRC_RGB, &value);
+        state.blendSrc = value;
+        glGetIntegerv(GL_BLEND_DST_RGB, &value);
+        state.blendDst = value;
+        glGetIntegerv(GL_DEPTH_FUNC, &value);
+        state.depthFunc = value;
+        glGetFloatv(GL_DEPTH_CLEAR_VALUE, &state.clearDepth);
+        addResource(CAPTURE_STATE, 0, std::vector<unsigned char>((unsigned char*)&state, (unsigned char*)&state + sizeof(state)));
+    }
+
+    void write() {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        CaptureHeader header = { CAPTURE_MAGIC, CAPTURE_VERSION, (uint32_t)viewport[2], (uint32_t)viewport[3],
+                                 (uint32_t)framesCaptured, resourceCount, commands.size() };
+
+        FILE* f = fopen(path.c_str(), "wb");
+        bool written = f != NULL
+            && fwrite(&header, sizeof(header), 1, f) == 1
+            && fwrite(resources.data(), 1, resources.size(), f) == resources.size()
+            && fwrite(commands.data(), 1, commands.size(), f) == commands.size();
+        if (f != NULL)
+            fclose(f);
+        if (written)
+            std::cout << "captured " << framesCaptured << " frame(s) to " << path << " (" << (resources.size() + commands.size()) / 1024 << " KB)" << std::endl;
+        finish(written);
+    }
+
+    void finish(bool written) {
+        if (!written)
+            std::cout << "ERROR::CAPTURE::NOT_WRITTEN " << path << std::endl;
+        commands.clear();
+        commands.shrink_to_fit();
+        resources.clear();
+        resources.shrink_to_fit();
+    }
+
+    // false with neither sources nor a binary to store
+    bool readProgram(unsigned int program, std::vector<unsigned char>& payload) {
+        const ProgramSources::Sources* sources = ProgramSources::Instance().Find(program);
+        std::vector<unsigned char> binary;
+        GLenum format = 0;
+        GLint length = 0;
+        if (getProgramBinary != nullptr)
+            glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length > 0) {
+            binary.resize(length);
+            getProgramBinary(program, length, &length, &format, binary.data());
+            binary.resize(length);
+        }
+        if (sources == nullptr && binary.empty())
+            return false;
+
+        CaptureProgram info = {};
+        info.binaryFormat = format;
+        info.binaryBytes = (uint32_t)binary.size();
+        payload.assign(sizeof(info), 0);
+        append(payload, binary.data(), binary.size());
+        if (sources != nullptr) {
+            info.vertexBytes = (uint32_t)sources->Vertex.size();
+            info.fragmentBytes = (uint32_t)sources->Fragment.size();
+            info.geometryBytes = (uint32_t)sources->Geometry.size();
+            append(payload, sources->Vertex.data(), sources->Vertex.size());
+            append(payload, sources->Fragment.data(), sources->Fragment.size());
+            append(payload, sources->Geometry.data(), sources->Geometry.size());
+        }
+
+        char name[256];
+        GLint count = 0, size = 0;
+        GLenum type = 0;
+        glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+        for (GLint i = 0; i < count; i++) {
+            glGetActiveAttrib(program, i, sizeof(name), nullptr, &size, &type, name);
+            if (appendBinding(payload, name, glGetAttribLocation(program, name)))
+                info.attributes++;
+        }
+        if (sources != nullptr) {
+            for (const std::string& output : fragmentOutputs(sources->Fragment))
+                if (appendBinding(payload, output, glGetFragDataLocation(program, output.c_str())))
+                    info.outputs++;
+        }
+        // every element of an array, since the renderer looks them up singly
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        for (GLint i = 0; i < count; i++) {
+            glGetActiveUniform(program, i, sizeof(name), nullptr, &size, &type, name);
+            std::string uniform = name;
+            bool array = uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0;
+            if (!array) {
+                if (appendBinding(payload, uniform, glGetUniformLocation(program, name)))
+                    info.uniforms++;
+                continue;
+            }
+            uniform.resize(uniform.size() - 3);
+            for (GLint e = 0; e < size; e++) {
+                std::string element = uniform + "[" + std::to_string(e) + "]";
+                if (appendBinding(payload, element, glGetUniformLocation(program, element.c_str())))
+                    info.uniforms++;
+            }
+        }
+        memcpy(payload.data(), &info, sizeof(info));
+        return true;
+    }
+
+    // false for built-ins and anything else without a location
+    static bool appendBinding(std::vector<unsigned char>& payload, const std::string& name, GLint location) {
+        if (location < 0)
+            return false;
+        CaptureBinding binding = { location, (uint32_t)name.size() };
+        append(payload, &binding, sizeof(binding));
+        append(payload, name.data(), name.size());
+        return true;
+    }
+
+    // names of the "out" variables a fragment shader declares; GL 3.3 has
+    // no query that lists them
+    static std::vector<std::string> fragmentOutputs(const std::string& source) {
+        std::vector<std::string> names;
+        size_t line = 0;
+        while (line < source.size()) {
+            size_t end = source.find('\n', line);
+            if (end == std::string::npos)
+                end = source.size();
+            std::string text = source.substr(line, end - line);
+            line = end + 1;
+            size_t at = text.find_first_not_of(" \t");
+            if (at != std::string::npos && text.compare(at, 6, "layout") == 0) {
+                at = text.find(')', at);
+                at = at == std::string::npos ? at : text.find_first_not_of(" \t", at + 1);
+            }
+            if (at == std::string::npos || text.compare(at, 4, "out ") != 0)
+                continue;
+            size_t semicolon = text.find(';', at);
+            if (semicolon == std::string::npos)
+                continue;
+            // "out vec4 FragColor;": the last word, less any array size
+            std::string declaration = text.substr(at + 4, std::min(semicolon, text.find('[', at)) - at - 4);
+            std::istringstream words(declaration);
+            std::string word, last;
+            while (words >> word)
+                last = word;
+            if (!last.empty())
+                names.push_back(last);
+        }
+        return names;
+    }
+
+    void readVertexArray(unsigned int vao, std::vector<unsigned char>& payload, std::set<unsigned int>& buffers) {
+        payload.clear();
+        glBindVertexArray(vao);
+        GLint elementBuffer = 0;
+        glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &elementBuffer);
+        uint32_t element32 = elementBuffer;
+        append(payload, &element32, sizeof(element32));
+        if (elementBuffer != 0)
+            buffers.insert(elementBuffer);
+
+        GLint maxAttribs = 0;
+        glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &maxAttribs);
+        for (GLint i = 0; i < maxAttribs; i++) {
+            GLint enabled = 0;
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+            if (!enabled)
+                continue;
+            CaptureAttrib attrib = {};
+            GLint value;
+            attrib.index = i;
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &value);
+            attrib.buffer = value;
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_SIZE, &attrib.size);
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_TYPE, &value);
+            attrib.type = value;
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &attrib.normalized);
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &attrib.integer);
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &attrib.stride);
+            void* offset = nullptr;
+            glGetVertexAttribPointerv(i, GL_VERTEX_ATTRIB_ARRAY_POINTER, &offset);
+            attrib.offset = (uint64_t)(size_t)offset;
+            append(payload, &attrib, sizeof(attrib));
+            if (attrib.buffer != 0)
+                buffers.insert(attrib.buffer);
+        }
+    }
+
+    void readBuffer(unsigned int buffer, std::vector<unsigned char>& payload) {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        GLint size = 0;
+        glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+        payload.resize(size);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, size, payload.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+
+    // every defined level; a texture still streaming in is captured empty.
+    // Float formats (the horizon's heightmap) are read back as floats, since
+    // RGBA8 would clamp heights to 0-1
+    void readTexture(unsigned int texture, GLenum textureTarget, std::vector<unsigned char>& payload) {
+        payload.assign(sizeof(CaptureTexture), 0);
+        CaptureTexture info = {};
+        info.target = textureTarget;
+        glBindTexture(textureTarget, texture);
+        glGetTexParameteriv(textureTarget, GL_TEXTURE_MIN_FILTER, &info.minFilter);
+        glGetTexParameteriv(textureTarget, GL_TEXTURE_MAG_FILTER, &info.magFilter);
+        glGetTexParameteriv(textureTarget, GL_TEXTURE_WRAP_S, &info.wrapS);
+        glGetTexParameteriv(textureTarget, GL_TEXTURE_WRAP_T, &info.wrapT);
+        GLint maxLevel = 0;
+        glGetTexParameteriv(textureTarget, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        for (GLint level = 0; level <= maxLevel; level++) {
+            CaptureLevel l = {};
+            GLint value = 0;
+            glGetTexLevelParameteriv(textureTarget, level, GL_TEXTURE_WIDTH, &value);
+            if (value == 0)
+                break;
+            l.width = value;
+            glGetTexLevelParameteriv(textureTarget, level, GL_TEXTURE_HEIGHT, &value);
+            l.height = value;
+            glGetTexLevelParameteriv(textureTarget, level, GL_TEXTURE_DEPTH, &value);
+            l.depth = value;
+            glGetTexLevelParameteriv(textureTarget, level, GL_TEXTURE_INTERNAL_FORMAT, &value);
+            l.internalFormat = value;
+            glGetTexLevelParameteriv(textureTarget, level, GL_TEXTURE_COMPRESSED, &value);
+            l.compressed = value;
+            glGetTexLevelParameteriv(textureTarget, level, GL_TEXTURE_RED_TYPE, &value);
+            l.type = value == GL_FLOAT ? GL_FLOAT : GL_UNSIGNED_BYTE;
+            if (l.compressed) {
+                glGetTexLevelParameteriv(textureTarget, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &value);
+                l.bytes = value;
+            }
+            else {
+                l.bytes = l.width * l.height * l.depth * 4 * (l.type == GL_FLOAT ? sizeof(float) : 1);
+            }
+            size_t at = payload.size();
+            append(payload, &l, sizeof(l));
+            payload.resize(at + sizeof(l) + l.bytes);
+            if (l.compressed)
+                glGetCompressedTexImage(textureTarget, level, payload.data() + at + sizeof(l));
+            else
+                glGetTexImage(textureTarget, level, GL_RGBA, l.type, payload.data() + at + sizeof(l));
+            info.levels++;
+        }
+        memcpy(payload.data(), &info, sizeof(info));
+    }
+};
+
+#endif
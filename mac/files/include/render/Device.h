@@ -0,0 +1,168 @@
+#ifndef DEVICE_H
+#define DEVICE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+// what the renderer asked the device to do, counted before the call is passed
+// on, so a NullDevice run reports the same numbers as a GlDevice run. The
+// counters only grow; see render/RenderStats.h for per-frame numbers.
+struct DeviceCounters {
+    uint64_t Calls = 0;
+    uint64_t DrawCalls = 0;
+    uint64_t Vertices = 0;          // indices drawn
+    uint64_t Triangles = 0;
+    uint64_t StateChanges = 0;      // program, vertex array and texture binds, texture units
+    uint64_t ProgramBinds = 0;
+    uint64_t VertexArrayBinds = 0;
+    uint64_t TextureBinds = 0;
+    uint64_t UniformCalls = 0;
+    uint64_t UniformBytes = 0;
+    uint64_t BufferBytes = 0;       // uploaded with BufferData/BufferSubData
+    uint64_t TextureBytes = 0;      // uploaded with TexSubImage3D, less row padding
+
+    void Reset() {
+        *this = DeviceCounters();
+    }
+};
+
+// The per-frame GL calls the renderer makes: clears, binds, uniforms, draws
+// and buffer and texture uploads. One-time setup (vertex layouts, textures, shader
+// compiles) still talks to GL directly. Public calls count themselves and
+// forward to the do*() functions an implementation overrides.
+class Device {
+public:
+    DeviceCounters Counters;
+
+    virtual ~Device() {}
+
+    void Clear(float r, float g, float b, float a, GLbitfield mask) {
+        Counters.Calls++;
+        doClear(r, g, b, a, mask);
+    }
+
+    void UseProgram(unsigned int program) {
+        Counters.Calls++;
+        Counters.StateChanges++;
+        Counters.ProgramBinds++;
+        doUseProgram(program);
+    }
+
+    void BindVertexArray(unsigned int vao) {
+        Counters.Calls++;
+        Counters.StateChanges++;
+        Counters.VertexArrayBinds++;
+        doBindVertexArray(vao);
+    }
+
+    void BindTexture(GLenum target, unsigned int texture) {
+        Counters.Calls++;
+        Counters.StateChanges++;
+        Counters.TextureBinds++;
+        doBindTexture(target, texture);
+    }
+
+    // unit is GL_TEXTURE0 + n; later BindTexture calls bind on it
+    void ActiveTexture(GLenum unit) {
+        Counters.Calls++;
+        Counters.StateChanges++;
+        doActiveTexture(unit);
+    }
+
+    int UniformLocation(unsigned int program, const char* name) {
+        Counters.Calls++;
+        return doUniformLocation(program, name);
+    }
+
+    // components is 1-4 for scalars and vectors
+    void UniformInts(int location, int components, const int* values) {
+        countUniform(components * sizeof(int));
+        doUniformInts(location, components, values);
+    }
+
+    void UniformFloats(int location, int components, const float* values) {
+        countUniform(components * sizeof(float));
+        doUniformFloats(location, components, values);
+    }
+
+    // size x size column-major matrix, size is 2-4
+    void UniformMatrix(int location, int size, const float* values) {
+        countUniform(size * size * sizeof(float));
+        doUniformMatrix(location, size, values);
+    }
+
+    void DrawElements(GLenum mode, int count, GLenum type, size_t offset) {
+        countDraw(mode, count);
+        doDrawElements(mode, count, type, offset);
+    }
+
+    void DrawArrays(GLenum mode, int first, int count) {
+        countDraw(mode, count);
+        doDrawArrays(mode, first, count);
+    }
+
+    // the buffer bound to target
+    void BufferData(GLenum target, size_t size, const void* data, GLenum usage) {
+        Counters.Calls++;
+        Counters.BufferBytes += data != nullptr ? size : 0;
+        doBufferData(target, size, data, usage);
+    }
+
+    void BufferSubData(GLenum target, size_t offset, size_t size, const void* data) {
+        Counters.Calls++;
+        Counters.BufferBytes += size;
+        doBufferSubData(target, offset, size, data);
+    }
+
+    // the texture bound to target on the active unit; data is width x height
+    // x depth texels of format and type, rows padded to GL_UNPACK_ALIGNMENT
+    void TexSubImage3D(GLenum target, int level, int x, int y, int z, int width, int height, int depth,
+                       GLenum format, GLenum type, const void* data) {
+        Counters.Calls++;
+        Counters.TextureBytes += (uint64_t)width * height * depth * TexelBytes(format, type);
+        doTexSubImage3D(target, level, x, y, z, width, height, depth, format, type, data);
+    }
+
+protected:
+    virtual void doClear(float r, float g, float b, float a, GLbitfield mask) = 0;
+    virtual void doUseProgram(unsigned int program) = 0;
+    virtual void doBindVertexArray(unsigned int vao) = 0;
+    virtual void doBindTexture(GLenum target, unsigned int texture) = 0;
+    virtual void doActiveTexture(GLenum unit) = 0;
+    virtual int doUniformLocation(unsigned int program, const char* name) = 0;
+    virtual void doUniformInts(int location, int components, const int* values) = 0;
+    virtual void doUniformFloats(int location, int components, const float* values) = 0;
+    virtual void doUniformMatrix(int location, int size, const float* values) = 0;
+    virtual void doDrawElements(GLenum mode, int count, GLenum type, size_t offset) = 0;
+    virtual void doDrawArrays(GLenum mode, int first, int count) = 0;
+    virtual void doBufferData(GLenum target, size_t size, const void* data, GLenum usage) = 0;
+    virtual void doBufferSubData(GLenum target, size_t offset, size_t size, const void* data) = 0;
+    virtual void doTexSubImage3D(GLenum target, int level, int x, int y, int z, int width, int height, int depth,
+                                 GLenum format, GLenum type, const void* data) = 0;
+
+    // the size of one texel of an uncompressed format and type
+    static size_t TexelBytes(GLenum format, GLenum type) {
+        size_t components = format == GL_RED ? 1 : format == GL_RG ? 2 : format == GL_RGB ? 3 : 4;
+        return components * (type == GL_FLOAT ? sizeof(float) : type == GL_HALF_FLOAT ? 2 : 1);
+    }
+
+private:
+    void countUniform(size_t bytes) {
+        Counters.Calls++;
+        Counters.UniformCalls++;
+        Counters.UniformBytes += bytes;
+    }
+
+    void countDraw(GLenum mode, int count) {
+        Counters.Calls++;
+        Counters.DrawCalls++;
+        Counters.Vertices += count;
+        if (mode == GL_TRIANGLES)
+            Counters.Triangles += count / 3;
+        else if (mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN)
+            Counters.Triangles += count > 2 ? count - 2 : 0;
+    }
+};
+
+#endif
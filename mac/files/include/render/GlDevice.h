@@ -0,0 +1,91 @@
+#ifndef GL_DEVICE_H
+#define GL_DEVICE_H
+
+#include <glad/glad.h>
+
+#include "render/Device.h"
+
+// forwards every call to the current GL context
+class GlDevice : public Device {
+public:
+    // the device shaders use unless given another
+    static GlDevice& Instance() {
+        static GlDevice device;
+        return device;
+    }
+
+protected:
+    void doClear(float r, float g, float b, float a, GLbitfield mask) override {
+        glClearColor(r, g, b, a);
+        glClear(mask);
+    }
+
+    void doUseProgram(unsigned int program) override {
+        glUseProgram(program);
+    }
+
+    void doBindVertexArray(unsigned int vao) override {
+        glBindVertexArray(vao);
+    }
+
+    void doBindTexture(GLenum target, unsigned int texture) override {
+        glBindTexture(target, texture);
+    }
+
+    void doActiveTexture(GLenum unit) override {
+        glActiveTexture(unit);
+    }
+
+    int doUniformLocation(unsigned int program, const char* name) override {
+        return glGetUniformLocation(program, name);
+    }
+
+    void doUniformInts(int location, int components, const int* values) override {
+        switch (components) {
+            case 1: glUniform1iv(location, 1, values); break;
+            case 2: glUniform2iv(location, 1, values); break;
+            case 3: glUniform3iv(location, 1, values); break;
+            case 4: glUniform4iv(location, 1, values); break;
+        }
+    }
+
+    void doUniformFloats(int location, int components, const float* values) override {
+        switch (components) {
+            case 1: glUniform1fv(location, 1, values); break;
+            case 2: glUniform2fv(location, 1, values); break;
+            case 3: glUniform3fv(location, 1, values); break;
+            case 4: glUniform4fv(location, 1, values); break;
+        }
+    }
+
+    void doUniformMatrix(int location, int size, const float* values) override {
+        switch (size) {
+            case 2: glUniformMatrix2fv(location, 1, GL_FALSE, values); break;
+            case 3: glUniformMatrix3fv(location, 1, GL_FALSE, values); break;
+            case 4: glUniformMatrix4fv(location, 1, GL_FALSE, values); break;
+        }
+    }
+
+    void doDrawElements(GLenum mode, int count, GLenum type, size_t offset) override {
+        glDrawElements(mode, count, type, (void*)offset);
+    }
+
+    void doDrawArrays(GLenum mode, int first, int count) override {
+        glDrawArrays(mode, first, count);
+    }
+
+    void doBufferData(GLenum target, size_t size, const void* data, GLenum usage) override {
+        glBufferData(target, size, data, usage);
+    }
+
+    void doBufferSubData(GLenum target, size_t offset, size_t size, const void* data) override {
+        glBufferSubData(target, offset, size, data);
+    }
+
+    void doTexSubImage3D(GLenum target, int level, int x, int y, int z, int width, int height, int depth,
+                         GLenum format, GLenum type, const void* data) override {
+        glTexSubImage3D(target, level, x, y, z, width, height, depth, format, type, data);
+    }
+};
+
+#endif
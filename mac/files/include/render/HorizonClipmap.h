@@ -0,0 +1,439 @@
+#ifndef HORIZON_CLIPMAP_H
+#define HORIZON_CLIPMAP_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+
+#include "block/Block.h"
+#include "render/Device.h"
+#include "shader/shader_s.h"
+#include "memory/MemoryTracker.h"
+
+// Terrain out to the horizon, past where blocks are drawn, from a heightmap
+// of the world instead of its blocks. Each column's surface height and top
+// block are reduced into a pyramid of coarser grids, 2x2 cells at a time, to
+// the mean height and the block type covering most columns. The clipmap is
+// Levels square windows onto that pyramid, CELLS across, each at twice the
+// spacing of the one inside it and all following the eye. A level's window
+// lives in one layer of a texture array, addressed toroidally (a cell's
+// texel is its coordinate modulo SIZE), so when the eye moves only the rows
+// and columns coming into view are written. One static grid mesh covers
+// every level and is drawn in a single call; the shaders place it from the
+// window origins, cut each level's middle out for the level inside, and
+// stitch each window's edge to the level around it.
+class HorizonClipmap {
+public:
+    static const int CELLS = 64;            // cells across a level; even, so windows nest
+    static const int SIZE = CELLS + 1;      // vertices, and texels, across a level
+    static const int MAX_LEVELS = 8;        // levelOrigin[] in the shaders
+
+    // Horizon options
+    int Levels = 7;                         // 0 turns the horizon off
+    int BaseSpacing = 2;                    // blocks per cell in the finest level, a power of two
+
+    HorizonClipmap() {
+        texels.reserve(SIZE * SIZE * 2);
+        changed.reserve(CHANGED_CAPACITY);
+    }
+
+    ~HorizonClipmap() {
+        release();
+    }
+
+    HorizonClipmap(const HorizonClipmap&) = delete;
+    HorizonClipmap& operator=(const HorizonClipmap&) = delete;
+
+    bool Enabled() const {
+        return texture != 0;
+    }
+
+    // distance from the eye to the edge of the coarsest level
+    float Range() const {
+        return CELLS / 2 * spacing(Levels - 1);
+    }
+
+    // distance from the eye to the nearest edge of the world, past which
+    // the heightmap is empty; 0 outside it
+    float EdgeDistance(const glm::vec3& eye) const {
+        float x = std::min(eye.x - worldMin.x, worldMax.x + 1 - eye.x);
+        float z = std::min(eye.z - worldMin.y, worldMax.y + 1 - eye.z);
+        return std::max(std::min(x, z), 0.0f);
+    }
+
+    // heightmap of world and the texture and mesh for it; call with the GL
+    // context current. Uploads go through texture unit 1, so the block
+    // textures on unit 0 stay bound.
+    void Build(const std::vector<Block>& world) {
+        release();
+        changed.clear();
+        Levels = std::min(Levels, MAX_LEVELS);
+        if (Levels <= 0 || world.empty())
+            return;
+        baseLevel = 0;
+        while ((2 << baseLevel) <= BaseSpacing)
+            baseLevel++;
+
+        // columns, padded to whole cells of the coarsest level
+        int top = baseLevel + Levels - 1;
+        int minX = INT_MAX, minZ = INT_MAX, maxX = INT_MIN, maxZ = INT_MIN;
+        for (const Block& b : world) {
+            minX = std::min(minX, (int)std::floor(b.position.x));
+            minZ = std::min(minZ, (int)std::floor(b.position.z));
+            maxX = std::max(maxX, (int)std::floor(b.position.x));
+            maxZ = std::max(maxZ, (int)std::floor(b.position.z));
+        }
+        worldMin = glm::ivec2(minX, minZ);
+        worldMax = glm::ivec2(maxX, maxZ);
+        originX = (minX >> top) << top;
+        originZ = (minZ >> top) << top;
+        width = (((maxX >> top) + 1) << top) - originX;
+        depth = (((maxZ >> top) + 1) << top) - originZ;
+        pyramid.resize(top + 1);
+        int64_t cells = 0;
+        for (int p = 0; p <= top; p++) {
+            pyramid[p].assign((size_t)(width >> p) * (depth >> p), Cell { 0.0f, -1, 0 });
+            cells += (int64_t)pyramid[p].size();
+        }
+        for (const Block& b : world) {
+            Cell& c = pyramid[0][index(0, (int)std::floor(b.position.x), (int)std::floor(b.position.z))];
+            float surface = std::floor(b.position.y) + 1.0f;
+            if (c.type < 0 || surface > c.height)
+                c = Cell { surface, (int)b.bt, 1 };
+        }
+        for (int p = 1; p <= top; p++)
+            for (int z = 0; z < depth >> p; z++)
+                for (int x = 0; x < width >> p; x++)
+                    reduce(p, (originX >> p) + x, (originZ >> p) + z);
+        pending.assign(pyramid[0].size(), 0);
+        heightmapMemory.Set(cells * (int64_t)sizeof(Cell) + (int64_t)pending.size());
+
+        glGenTextures(1, &texture);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RG32F, SIZE, SIZE, Levels, 0, GL_RG, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+        glActiveTexture(GL_TEXTURE0);
+        textureMemory.Set((int64_t)SIZE * SIZE * Levels * 2 * sizeof(float));
+        for (int l = 0; l < Levels; l++)
+            placed[l] = false;
+
+        // every level's grid, less the middle the level inside always covers;
+        // the shaders cut out the rest, which depends on where the eye is
+        std::vector<float> vertices;
+        std::vector<GLuint> indices;
+        vertices.reserve(SIZE * SIZE * 3 * Levels);
+        for (int l = 0; l < Levels; l++) {
+            GLuint first = (GLuint)(vertices.size() / 3);
+            for (int z = 0; z < SIZE; z++)
+                for (int x = 0; x < SIZE; x++) {
+                    const float v[3] = { (float)x, (float)z, (float)l };
+                    vertices.insert(vertices.end(), v, v + 3);
+                }
+            for (int z = 0; z < CELLS; z++)
+                for (int x = 0; x < CELLS; x++) {
+                    if (l > 0 && covered(x) && covered(z))
+                        continue;
+                    GLuint i = first + z * SIZE + x;
+                    const GLuint q[6] = { i, i + 1, i + SIZE + 1, i, i + SIZE + 1, i + SIZE };
+                    indices.insert(indices.end(), q, q + 6);
+                }
+        }
+        indexCount = (int)indices.size();
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ebo);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindVertexArray(0);
+        meshMemory.Set((int64_t)(vertices.size() * sizeof(float) + indices.size() * sizeof(GLuint)));
+        bufferMemory.Set(meshMemory.Get());
+    }
+
+    // the block at position was placed or removed; its column is read again
+    // by the next Update(). One outside the heightmap grows it, which costs
+    // a copy of the pyramid but nothing on the GPU.
+    void Changed(const glm::vec3& position) {
+        if (!Enabled())
+            return;
+        int x = (int)std::floor(position.x), z = (int)std::floor(position.z);
+        if (x < originX || z < originZ || x >= originX + width || z >= originZ + depth)
+            grow(x, z);
+        worldMin = glm::min(worldMin, glm::ivec2(x, z));
+        worldMax = glm::max(worldMax, glm::ivec2(x, z));
+        uint8_t& flag = pending[index(0, x, z)];
+        if (!flag)
+            changed.push_back(glm::ivec2(x, z));
+        flag = 1;
+    }
+
+    // brings the heightmap up to date with world and moves the windows to
+    // follow eye, writing the texels that changed
+    void Update(Device& device, const std::vector<Block>& world, const glm::vec3& eye) {
+        if (!Enabled())
+            return;
+
+        // changed columns, then every cell above them
+        for (const glm::ivec2& column : changed)
+            pyramid[0][index(0, column.x, column.y)] = Cell { 0.0f, -1, 0 };
+        if (!changed.empty()) {
+            for (const Block& b : world) {
+                glm::ivec2 column((int)std::floor(b.position.x), (int)std::floor(b.position.z));
+                if (!pending[index(0, column.x, column.y)])
+                    continue;
+                Cell& c = pyramid[0][index(0, column.x, column.y)];
+                float surface = std::floor(b.position.y) + 1.0f;
+                if (c.type < 0 || surface > c.height)
+                    c = Cell { surface, (int)b.bt, 1 };
+            }
+            for (const glm::ivec2& column : changed)
+                for (int p = 1; p < (int)pyramid.size(); p++)
+                    reduce(p, column.x >> p, column.y >> p);
+            for (const glm::ivec2& column : changed)
+                pending[index(0, column.x, column.y)] = 0;
+        }
+
+        bound = false;
+        for (int l = 0; l < Levels; l++) {
+            // even, so the window's edges fall on the next level's cells
+            float s = spacing(l);
+            glm::ivec2 next(2 * (int)std::floor(eye.x / s / 2.0f) - CELLS / 2, 2 * (int)std::floor(eye.z / s / 2.0f) - CELLS / 2);
+            glm::ivec2 previous = origin[l];
+            origin[l] = next;
+            if (!placed[l] || std::abs(next.x - previous.x) >= SIZE || std::abs(next.y - previous.y) >= SIZE) {
+                writeLevel(device, l);
+                placed[l] = true;
+                continue;
+            }
+            // columns, then rows, that came into the window
+            for (int x = previous.x + SIZE; x < next.x + SIZE; x++)
+                writeColumn(device, l, x);
+            for (int x = next.x; x < previous.x; x++)
+                writeColumn(device, l, x);
+            for (int z = previous.y + SIZE; z < next.y + SIZE; z++)
+                writeRow(device, l, z);
+            for (int z = next.y; z < previous.y; z++)
+                writeRow(device, l, z);
+            for (const glm::ivec2& column : changed) {
+                int p = baseLevel + l;
+                glm::ivec2 cell(column.x >> p, column.y >> p);
+                if (cell.x >= next.x && cell.y >= next.y && cell.x <= next.x + CELLS && cell.y <= next.y + CELLS)
+                    writeTexel(device, l, cell.x, cell.y);
+            }
+        }
+        if (bound)
+            device.ActiveTexture(GL_TEXTURE0);
+        changed.clear();
+    }
+
+    // draws every level with shader in use, its other uniforms set and the
+    // block textures bound; binds the heightmap to texture unit 1
+    void Draw(Device& device, const Shader& shader) const {
+        static const char* const origins[MAX_LEVELS] = {
+            "levelOrigin[0]", "levelOrigin[1]", "levelOrigin[2]", "levelOrigin[3]",
+            "levelOrigin[4]", "levelOrigin[5]", "levelOrigin[6]", "levelOrigin[7]",
+        };
+        for (int l = 0; l < Levels; l++)
+            shader.setIVec2(origins[l], origin[l].x, origin[l].y);
+        shader.setInt("levels", Levels);
+        shader.setFloat("baseSpacing", (float)BaseSpacing);
+        shader.setInt("horizonHeights", 1);
+        device.ActiveTexture(GL_TEXTURE1);
+        device.BindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        device.ActiveTexture(GL_TEXTURE0);
+        device.BindVertexArray(vao);
+        device.DrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+    }
+
+private:
+    static const size_t CHANGED_CAPACITY = 64;    // edits a frame before changed grows
+
+    struct Cell {
+        float height;   // mean surface height of its columns
+        int type;       // BlockType on top of most of them, -1 if they are all empty
+        int columns;    // how many are not
+    };
+
+    // pyramid[p] has cells of 2^p columns; level l of the clipmap reads
+    // pyramid[baseLevel + l]
+    std::vector<std::vector<Cell>> pyramid;
+    int baseLevel = 0;
+    int originX = 0, originZ = 0;           // first column of the heightmap
+    int width = 0, depth = 0;               // columns across it
+    glm::ivec2 worldMin, worldMax;          // first and last column with blocks
+    std::vector<glm::ivec2> changed;
+    std::vector<uint8_t> pending;           // 1 for the columns in changed, laid out like pyramid[0]
+
+    glm::ivec2 origin[MAX_LEVELS];          // first cell of each level's window
+    bool placed[MAX_LEVELS] = {};           // false until the window is written
+    std::vector<float> texels;              // a row, column or level being written
+    bool bound = false;                     // texture is bound on unit 1 for this Update()
+    unsigned int texture = 0, vao = 0, vbo = 0, ebo = 0;
+    int indexCount = 0;
+    MemoryGauge heightmapMemory { MEMORY_WORLD };
+    MemoryGauge textureMemory { MEMORY_TEXTURES };
+    MemoryGauge meshMemory { MEMORY_GEOMETRY };
+    MemoryGauge bufferMemory { MEMORY_GPU_BUFFERS };
+
+    float spacing(int level) const {
+        return (float)(BaseSpacing << level);
+    }
+
+    // true for cells of a level that the level inside it covers wherever
+    // the eye is: its window starts 16 or 17 of these cells in
+    static bool covered(int cell) {
+        return cell >= CELLS / 4 + 1 && cell < CELLS * 3 / 4;
+    }
+
+    size_t index(int p, int x, int z) const {
+        return (size_t)((z - (originZ >> p)) * (width >> p) + (x - (originX >> p)));
+    }
+
+    const Cell* cell(int p, int x, int z) const {
+        if (x < originX >> p || z < originZ >> p || x >= (originX + width) >> p || z >= (originZ + depth) >> p)
+            return nullptr;
+        return &pyramid[p][index(p, x, z)];
+    }
+
+    // widens every grid of the pyramid, in whole cells of the coarsest level,
+    // to take in column x, z; the cells already there keep their values
+    void grow(int x, int z) {
+        int top = (int)pyramid.size() - 1;
+        int newX = std::min(originX, (x >> top) << top);
+        int newZ = std::min(originZ, (z >> top) << top);
+        int newWidth = std::max(originX + width, ((x >> top) + 1) << top) - newX;
+        int newDepth = std::max(originZ + depth, ((z >> top) + 1) << top) - newZ;
+        int64_t cells = 0;
+        for (int p = 0; p <= top; p++) {
+            std::vector<Cell> grid((size_t)(newWidth >> p) * (newDepth >> p), Cell { 0.0f, -1, 0 });
+            int dx = (originX - newX) >> p, dz = (originZ - newZ) >> p;
+            for (int row = 0; row < depth >> p; row++)
+                std::copy(pyramid[p].begin() + (size_t)row * (width >> p), pyramid[p].begin() + (size_t)(row + 1) * (width >> p),
+                          grid.begin() + (size_t)(row + dz) * (newWidth >> p) + dx);
+            pyramid[p].swap(grid);
+            cells += (int64_t)pyramid[p].size();
+        }
+        originX = newX;
+        originZ = newZ;
+        width = newWidth;
+        depth = newDepth;
+        pending.assign(pyramid[0].size(), 0);
+        for (const glm::ivec2& column : changed)
+            pending[index(0, column.x, column.y)] = 1;
+        heightmapMemory.Set(cells * (int64_t)sizeof(Cell) + (int64_t)pending.size());
+    }
+
+    // the cell at x, z of pyramid[p] from the four below it
+    void reduce(int p, int x, int z) {
+        const int TYPES = sizeof(BlockTextureLayers) / sizeof(BlockTextureLayers[0]);
+        int counts[TYPES] = {};
+        float sum = 0.0f;
+        int columns = 0;
+        for (int j = 0; j < 2; j++)
+            for (int i = 0; i < 2; i++) {
+                const Cell& c = pyramid[p - 1][index(p - 1, 2 * x + i, 2 * z + j)];
+                if (c.type < 0)
+                    continue;
+                sum += c.height * c.columns;
+                columns += c.columns;
+                counts[c.type] += c.columns;
+            }
+        Cell& c = pyramid[p][index(p, x, z)];
+        if (columns == 0)
+            c = Cell { 0.0f, -1, 0 };
+        else
+            c = Cell { sum / columns, (int)(std::max_element(counts, counts + TYPES) - counts), columns };
+    }
+
+    // texel of cell x, z of level l: its height and top texture layer
+    void texel(int l, int x, int z) {
+        const Cell* c = cell(baseLevel + l, x, z);
+        if (c == nullptr || c->type < 0) {
+            texels.push_back(0.0f);
+            texels.push_back(-1.0f);
+        }
+        else {
+            texels.push_back(c->height);
+            texels.push_back((float)BlockTextureLayers[c->type][0]);
+        }
+    }
+
+    // the cell of level l's window stored at texel t along an axis whose
+    // window starts at first
+    static int windowCell(int first, int t) {
+        return first + ((t - first) % SIZE + SIZE) % SIZE;
+    }
+
+    static int wrap(int cell) {
+        return (cell % SIZE + SIZE) % SIZE;
+    }
+
+    // binds the heightmap on unit 1 before the first write of an Update(),
+    // leaving the block textures on unit 0 alone
+    void upload(Device& device, int l, int x, int z, int w, int h) {
+        if (!bound) {
+            device.ActiveTexture(GL_TEXTURE1);
+            device.BindTexture(GL_TEXTURE_2D_ARRAY, texture);
+            bound = true;
+        }
+        device.TexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, z, l, w, h, 1, GL_RG, GL_FLOAT, texels.data());
+    }
+
+    void writeLevel(Device& device, int l) {
+        texels.clear();
+        for (int t = 0; t < SIZE; t++)
+            for (int s = 0; s < SIZE; s++)
+                texel(l, windowCell(origin[l].x, s), windowCell(origin[l].y, t));
+        upload(device, l, 0, 0, SIZE, SIZE);
+    }
+
+    void writeColumn(Device& device, int l, int x) {
+        texels.clear();
+        for (int t = 0; t < SIZE; t++)
+            texel(l, x, windowCell(origin[l].y, t));
+        upload(device, l, wrap(x), 0, 1, SIZE);
+    }
+
+    void writeRow(Device& device, int l, int z) {
+        texels.clear();
+        for (int s = 0; s < SIZE; s++)
+            texel(l, windowCell(origin[l].x, s), z);
+        upload(device, l, 0, wrap(z), SIZE, 1);
+    }
+
+    void writeTexel(Device& device, int l, int x, int z) {
+        texels.clear();
+        texel(l, x, z);
+        upload(device, l, wrap(x), wrap(z), 1, 1);
+    }
+
+    void release() {
+        if (texture != 0) {
+            glDeleteTextures(1, &texture);
+            glDeleteVertexArrays(1, &vao);
+            glDeleteBuffers(1, &vbo);
+            glDeleteBuffers(1, &ebo);
+        }
+        texture = vao = vbo = ebo = 0;
+        pyramid.clear();
+        pending.clear();
+        heightmapMemory.Set(0);
+        textureMemory.Set(0);
+        meshMemory.Set(0);
+        bufferMemory.Set(0);
+    }
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef NULL_DEVICE_H
+#define NULL_DEVICE_H
+
+#include "render/Device.h"
+
+// Drops every call, so only the counters and the renderer's own CPU work
+// remain. Needs no GL context. Uniform locations are all 0.
+class NullDevice : public Device {
+protected:
+    void doClear(float, float, float, float, GLbitfield) override {}
+    void doUseProgram(unsigned int) override {}
+    void doBindVertexArray(unsigned int) override {}
+    void doBindTexture(GLenum, unsigned int) override {}
+    void doActiveTexture(GLenum) override {}
+    int doUniformLocation(unsigned int, const char*) override {
+        return 0;
+    }
+    void doUniformInts(int, int, const int*) override {}
+    void doUniformFloats(int, int, const float*) override {}
+    void doUniformMatrix(int, int, const float*) override {}
+    void doDrawElements(GLenum, int, GLenum, size_t) override {}
+    void doDrawArrays(GLenum, int, int) override {}
+    void doBufferData(GLenum, size_t, const void*, GLenum) override {}
+    void doBufferSubData(GLenum, size_t, size_t, const void*) override {}
+    void doTexSubImage3D(GLenum, int, int, int, int, int, int, int, GLenum, GLenum, const void*) override {}
+};
+
+#endif
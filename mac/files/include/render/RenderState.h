@@ -0,0 +1,108 @@
+#ifndef RENDER_STATE_H
+#define RENDER_STATE_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#include "block/Block.h"
+
+// a block placed or removed by the simulation
+struct BlockEdit {
+    Block block;
+    bool placed;
+};
+
+// Everything the renderer needs from one simulated frame: the camera's view
+// and field of view and the world changes since the frame before. The
+// renderer keeps its own copy of the world and applies Edits to it, and
+// builds the projection itself, with the far plane at its view distance.
+struct RenderState {
+    static const size_t EDIT_CAPACITY = 64;
+
+    glm::mat4 View = glm::mat4(1.0f);
+    float Zoom = 45.0f;             // vertical field of view, degrees
+    glm::vec3 ViewPos = glm::vec3(0.0f);
+    // the look View was built from, so the renderer can re-aim it with
+    // mouse movement the simulation has not applied yet
+    float Yaw = 0.0f, Pitch = 0.0f;
+    float MouseSensitivity = 0.0f;
+    bool CursorValid = false;       // false until the first cursor event
+    double CursorX = 0.0, CursorY = 0.0;
+    double InputTime = 0.0;         // newest cursor event applied, 0 if none
+    std::vector<BlockEdit> Edits;
+    int BenchmarkFrame = -1;        // script frame, or -1 outside the measured run
+    bool ToggleOverlay = false;
+    bool WriteTrace = false;
+
+    RenderState() {
+        Edits.reserve(EDIT_CAPACITY);
+    }
+
+    // ready for the next frame; the edits' storage is kept
+    void Clear() {
+        Edits.clear();
+        BenchmarkFrame = -1;
+        ToggleOverlay = false;
+        WriteTrace = false;
+    }
+};
+
+// Double-buffered hand-off from the simulation thread to the render thread.
+// The simulation fills Back() and publishes it; Publish() waits until the
+// renderer has picked the state up, which it does once it is done with the
+// frame before, so the other state is then free to be filled. Simulating
+// frame N + 1 overlaps rendering frame N, and neither thread gets more than
+// a frame ahead. Either side may Close() the buffer to stop the other.
+class RenderStateBuffer {
+public:
+    // simulation thread: the state for the next frame
+    RenderState& Back() {
+        return states[back];
+    }
+
+    // simulation thread: false once the buffer is closed
+    bool Publish() {
+        std::unique_lock<std::mutex> lock(mutex);
+        published = back;
+        ready = true;
+        changed.notify_all();
+        changed.wait(lock, [this] { return !ready || closed; });
+        if (closed)
+            return false;
+        back ^= 1;
+        states[back].Clear();
+        return true;
+    }
+
+    // render thread: waits for the next published state; nullptr once the
+    // buffer is closed. The state stays valid until the next Acquire().
+    const RenderState* Acquire() {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return ready || closed; });
+        if (closed)
+            return nullptr;
+        ready = false;
+        changed.notify_all();
+        return &states[published];
+    }
+
+    void Close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        changed.notify_all();
+    }
+
+private:
+    RenderState states[2];
+    int back = 0;
+    int published = 0;
+    bool ready = false;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable changed;
+};
+
+#endif
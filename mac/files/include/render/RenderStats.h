@@ -0,0 +1,160 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+
+#include "render/Device.h"
+
+// what one frame submitted
+struct FrameStats {
+    double Milliseconds = 0.0;
+    uint64_t DrawCalls = 0;
+    uint64_t Triangles = 0;
+    uint64_t Vertices = 0;
+    uint64_t ProgramBinds = 0;
+    uint64_t TextureBinds = 0;
+    uint64_t VertexArrayBinds = 0;
+    uint64_t UniformCalls = 0;
+    uint64_t UniformBytes = 0;
+    uint64_t BufferBytes = 0;
+    uint64_t TextureBytes = 0;
+};
+
+// Per-frame rendering statistics: the difference in the device counters (and
+// in textureBytes, texture uploads made outside the device) between
+// BeginFrame() and EndFrame(), kept for the last HISTORY frames, or for every
+// frame when RecordAll is set so they can be written out with WriteCsv().
+// Anything drawn after EndFrame(), such as the stats overlay itself, is left
+// out.
+class RenderStats {
+public:
+    static const size_t HISTORY = 240;
+
+    bool RecordAll = false;
+
+    RenderStats() {
+        history.reserve(HISTORY);
+    }
+
+    // makes room to record the next frame, so with RecordAll the record
+    // grows between frames rather than during one
+    void Reserve() {
+        if (RecordAll && all.size() == all.capacity())
+            all.reserve(all.capacity() * 2 + 256);
+    }
+
+    void BeginFrame(const DeviceCounters& counters, uint64_t textureBytes) {
+        begin = counters;
+        beginTextureBytes = textureBytes;
+    }
+
+    void EndFrame(const DeviceCounters& counters, uint64_t textureBytes) {
+        FrameStats frame;
+        frame.DrawCalls = counters.DrawCalls - begin.DrawCalls;
+        frame.Triangles = counters.Triangles - begin.Triangles;
+        frame.Vertices = counters.Vertices - begin.Vertices;
+        frame.ProgramBinds = counters.ProgramBinds - begin.ProgramBinds;
+        frame.TextureBinds = counters.TextureBinds - begin.TextureBinds;
+        frame.VertexArrayBinds = counters.VertexArrayBinds - begin.VertexArrayBinds;
+        frame.UniformCalls = counters.UniformCalls - begin.UniformCalls;
+        frame.UniformBytes = counters.UniformBytes - begin.UniformBytes;
+        frame.BufferBytes = counters.BufferBytes - begin.BufferBytes;
+        frame.TextureBytes = counters.TextureBytes - begin.TextureBytes + textureBytes - beginTextureBytes;
+        if (history.size() < HISTORY)
+            history.push_back(frame);
+        else
+            history[frames % HISTORY] = frame;
+        frames++;
+        if (RecordAll)
+            all.push_back(frame);
+    }
+
+    // wall time of the frame just ended, known only once it is presented
+    void SetFrameTime(double milliseconds) {
+        if (frames == 0)
+            return;
+        history[(frames - 1) % HISTORY].Milliseconds = milliseconds;
+        if (RecordAll)
+            all.back().Milliseconds = milliseconds;
+    }
+
+    size_t Frames() const {
+        return frames;
+    }
+
+    // age 0 is the last frame; age must be below Recent()
+    const FrameStats& Get(size_t age) const {
+        return history[(frames - 1 - age) % HISTORY];
+    }
+
+    size_t Recent() const {
+        return history.size();
+    }
+
+    // frame time is averaged over the frames that have one
+    FrameStats Average() const {
+        FrameStats sum;
+        size_t timed = 0;
+        for (const FrameStats& f : history) {
+            sum.Milliseconds += f.Milliseconds;
+            timed += f.Milliseconds > 0.0 ? 1 : 0;
+            sum.DrawCalls += f.DrawCalls;
+            sum.Triangles += f.Triangles;
+            sum.Vertices += f.Vertices;
+            sum.ProgramBinds += f.ProgramBinds;
+            sum.TextureBinds += f.TextureBinds;
+            sum.VertexArrayBinds += f.VertexArrayBinds;
+            sum.UniformCalls += f.UniformCalls;
+            sum.UniformBytes += f.UniformBytes;
+            sum.BufferBytes += f.BufferBytes;
+            sum.TextureBytes += f.TextureBytes;
+        }
+        size_t n = history.empty() ? 1 : history.size();
+        sum.Milliseconds /= timed > 0 ? timed : 1;
+        sum.DrawCalls /= n;
+        sum.Triangles /= n;
+        sum.Vertices /= n;
+        sum.ProgramBinds /= n;
+        sum.TextureBinds /= n;
+        sum.VertexArrayBinds /= n;
+        sum.UniformCalls /= n;
+        sum.UniformBytes /= n;
+        sum.BufferBytes /= n;
+        sum.TextureBytes /= n;
+        return sum;
+    }
+
+    bool WriteCsv(const std::string& path) const {
+        FILE* f = fopen(path.c_str(), "w");
+        if (f == NULL) {
+            std::cout << "ERROR::STATS::CSV_NOT_WRITTEN " << path << std::endl;
+            return false;
+        }
+        fprintf(f, "frame,ms,draws,triangles,vertices,program_binds,texture_binds,vao_binds,uniforms,uniform_bytes,buffer_bytes,texture_bytes\n");
+        for (size_t i = 0; i < all.size(); i++) {
+            const FrameStats& s = all[i];
+            fprintf(f, "%zu,%.3f,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n", i, s.Milliseconds,
+                    (unsigned long long)s.DrawCalls, (unsigned long long)s.Triangles, (unsigned long long)s.Vertices,
+                    (unsigned long long)s.ProgramBinds, (unsigned long long)s.TextureBinds, (unsigned long long)s.VertexArrayBinds,
+                    (unsigned long long)s.UniformCalls, (unsigned long long)s.UniformBytes,
+                    (unsigned long long)s.BufferBytes, (unsigned long long)s.TextureBytes);
+        }
+        bool ok = ferror(f) == 0;
+        fclose(f);
+        std::cout << "wrote " << all.size() << " frames of render stats to " << path << std::endl;
+        return ok;
+    }
+
+private:
+    DeviceCounters begin;
+    uint64_t beginTextureBytes = 0;
+    std::vector<FrameStats> history;
+    std::vector<FrameStats> all;
+    size_t frames = 0;
+};
+
+#endif
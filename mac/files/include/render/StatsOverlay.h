@@ -0,0 +1,176 @@
+#ifndef STATS_OVERLAY_H
+#define STATS_OVERLAY_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdarg>
+
+#include "asset/AssetPack.h"
+#include "shader/shader_s.h"
+#include "render/Device.h"
+#include "render/RenderStats.h"
+#include "memory/MemoryTracker.h"
+#include "memory/FrameAllocator.h"
+
+// 3x5 pixel glyphs, one row per 3 bits from the top
+inline unsigned int overlayGlyph(char c)
+{
+    static const unsigned int digits[10] = {
+        075557, 026227, 071747, 071717, 055711, 074717, 074757, 071111, 075757, 075717,
+    };
+    static const unsigned int letters[26] = {
+        025755, 065656, 034443, 065556, 074647, 074644, 034553, 055755, 072227, 011152,
+        055655, 044447, 057755, 065555, 025552, 065644, 025563, 065655, 034216, 072222,
+        055557, 055552, 055775, 055255, 055222, 071247,
+    };
+    if (c >= '0' && c <= '9')
+        return digits[c - '0'];
+    if (c >= 'A' && c <= 'Z')
+        return letters[c - 'A'];
+    switch (c) {
+        case '.': return 000002;
+        case ':': return 002020;
+        case '-': return 000700;
+        case '/': return 011244;
+        default: return 0;
+    }
+}
+
+// Rolling on-screen view of RenderStats: the last frame's counters as text and
+// a graph of recent frame times against the 60 and 30 fps budgets. Every
+// element is a solid quad, rebuilt and uploaded each frame; the text is
+// formatted into frame memory.
+class StatsOverlay {
+public:
+    bool Visible = false;
+
+    StatsOverlay(const AssetPack& assets, ShaderCache* cache) {
+        AssetView vs = assets.Get("shaders/overlay.vs");
+        AssetView fs = assets.Get("shaders/overlay.fs");
+        shader.startCompile(vs.text(), (GLint)vs.size, fs.text(), (GLint)fs.size, nullptr, 0, cache);
+        shader.finishCompile();
+
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+    }
+
+    ~StatsOverlay() {
+        glDeleteVertexArrays(1, &vao);
+        glDeleteBuffers(1, &vbo);
+        glDeleteProgram(shader.ID);
+    }
+
+    void Draw(Device& device, const RenderStats& stats, FrameAllocator& frame, int width, int height) {
+        if (!Visible || stats.Frames() == 0)
+            return;
+        vertices.clear();
+        const FrameStats& last = stats.Get(0);
+        FrameStats average = stats.Average();
+        // this frame has not been presented yet, so show the time of the one before
+        double lastMs = stats.Recent() > 1 ? stats.Get(1).Milliseconds : 0.0;
+
+        FrameArray<const char*> lines = frame.Array<const char*>(5);
+        lines.push_back(format(frame, "FRAME %.1f MS  AVG %.1f MS", lastMs, average.Milliseconds));
+        lines.push_back(format(frame, "DRAWS %llu  TRIS %llu  VERTS %llu", (unsigned long long)last.DrawCalls,
+                               (unsigned long long)last.Triangles, (unsigned long long)last.Vertices));
+        lines.push_back(format(frame, "BINDS PROG %llu  TEX %llu  VAO %llu", (unsigned long long)last.ProgramBinds,
+                               (unsigned long long)last.TextureBinds, (unsigned long long)last.VertexArrayBinds));
+        lines.push_back(format(frame, "UNIFORMS %llu  %llu KB", (unsigned long long)last.UniformCalls,
+                               (unsigned long long)last.UniformBytes / 1024));
+        lines.push_back(format(frame, "UPLOAD BUF %llu KB  TEX %llu KB", (unsigned long long)last.BufferBytes / 1024,
+                               (unsigned long long)last.TextureBytes / 1024));
+
+        const float margin = 8, lineHeight = 6 * SCALE + 4, graphHeight = 70;
+        float panelWidth = RenderStats::HISTORY + 2 * margin;
+        float panelHeight = margin * 3 + lines.Size * lineHeight + graphHeight;
+        quad(0, 0, panelWidth, panelHeight, BACK, 0.0f, 0.0f, 0.0f, 0.6f);
+
+        float y = margin;
+        for (const char* text : lines) {
+            this->text(margin, y, text);
+            y += lineHeight;
+        }
+
+        // frame times, newest on the right, 2 pixels per ms
+        float base = y + margin + graphHeight;
+        for (size_t age = 0; age < stats.Recent(); age++) {
+            double ms = stats.Get(age).Milliseconds;
+            float h = (float)std::min(ms * 2.0, (double)graphHeight);
+            float x = margin + RenderStats::HISTORY - 1 - age;
+            if (ms > 33.4)
+                quad(x, base - h, 1, h, FRONT, 0.9f, 0.2f, 0.2f, 1.0f);
+            else if (ms > 16.7)
+                quad(x, base - h, 1, h, FRONT, 0.9f, 0.8f, 0.2f, 1.0f);
+            else
+                quad(x, base - h, 1, h, FRONT, 0.3f, 0.9f, 0.3f, 1.0f);
+        }
+        quad(margin, base - 16.7f * 2, RenderStats::HISTORY, 1, FRONT, 1.0f, 1.0f, 1.0f, 0.5f);
+        quad(margin, base - 33.3f * 2, RenderStats::HISTORY, 1, FRONT, 1.0f, 1.0f, 1.0f, 0.5f);
+
+        shader.device = &device;
+        shader.use();
+        shader.setVec2("screenSize", (float)width, (float)height);
+        device.BindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        device.BufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STREAM_DRAW);
+        device.DrawArrays(GL_TRIANGLES, 0, (int)(vertices.size() / 7));
+        vertexMemory.Set((int64_t)(vertices.capacity() * sizeof(float)));
+        bufferMemory.Set((int64_t)(vertices.size() * sizeof(float)));
+    }
+
+private:
+    static constexpr float SCALE = 2;       // screen pixels per glyph pixel
+    static constexpr float BACK = -0.999f;  // depths; the text is drawn over the panel
+    static constexpr float FRONT = -1.0f;
+
+    Shader shader;
+    unsigned int vao = 0, vbo = 0;
+    std::vector<float> vertices;
+    MemoryGauge vertexMemory { MEMORY_GEOMETRY };
+    MemoryGauge bufferMemory { MEMORY_GPU_BUFFERS };
+
+    static const char* format(FrameAllocator& frame, const char* fmt, ...) {
+        const size_t LENGTH = 64;
+        char* line = frame.Allocate<char>(LENGTH);
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(line, LENGTH, fmt, args);
+        va_end(args);
+        return line;
+    }
+
+    void quad(float x, float y, float w, float h, float z, float r, float g, float b, float a) {
+        const float corners[6][2] = { { x, y }, { x + w, y }, { x + w, y + h }, { x, y }, { x + w, y + h }, { x, y + h } };
+        for (const auto& c : corners) {
+            const float v[7] = { c[0], c[1], z, r, g, b, a };
+            vertices.insert(vertices.end(), v, v + 7);
+        }
+    }
+
+    void text(float x, float y, const char* s) {
+        for (; *s; s++) {
+            char c = *s;
+            unsigned int bits = overlayGlyph(c);
+            for (int row = 0; row < 5; row++) {
+                for (int col = 0; col < 3; col++) {
+                    if (bits & (1u << ((4 - row) * 3 + (2 - col))))
+                        quad(x + col * SCALE, y + row * SCALE, SCALE, SCALE, FRONT, 1.0f, 1.0f, 1.0f, 1.0f);
+                }
+            }
+            x += 4 * SCALE;
+        }
+    }
+};
+
+#endif
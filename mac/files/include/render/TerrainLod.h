@@ -0,0 +1,390 @@
+#ifndef TERRAIN_LOD_H
+#define TERRAIN_LOD_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+
+#include "block/Block.h"
+#include "render/Device.h"
+#include "memory/MemoryTracker.h"
+
+// Far terrain drawn from downsampled geometry instead of one cube per block.
+// The world is split into regions of REGION_SIZE x REGION_SIZE columns, and
+// each region has a mesh at 2, 4 and 8 blocks per cell. A cell takes the top
+// surface of its columns, the highest block in it, so hills keep their
+// outline, and the block type most of its columns have on top. Cells get
+// walls down to lower neighbours, and every cell on a region's edge a skirt
+// down past the columns across it, so regions drawn at different levels meet
+// without cracks. Select() picks each region's level from its distance to
+// the eye: within LodDistance it is drawn block by block, beyond that at 2x,
+// at twice that 4x and at three times 8x.
+class TerrainLod {
+public:
+    static const int REGION_SIZE = 32;
+    static const int LEVELS = 3;            // 2x, 4x and 8x cells
+
+    // Level options
+    float LodDistance = 32.0f;              // 0 draws every region block by block
+
+    TerrainLod() {
+        // the most a mesh can hold: 2x cells, each with a top and four walls
+        int cells = (REGION_SIZE / 2) * (REGION_SIZE / 2);
+        vertices.reserve(cells * 5 * 4 * VERTEX_FLOATS);
+        indices.reserve(cells * 5 * 6);
+        vertexMemory.Set((int64_t)(vertices.capacity() * sizeof(float) + indices.capacity() * sizeof(GLuint)));
+    }
+
+    ~TerrainLod() {
+        release();
+    }
+
+    TerrainLod(const TerrainLod&) = delete;
+    TerrainLod& operator=(const TerrainLod&) = delete;
+
+    // regions covering world, every one built; call with the GL context current
+    void Build(const std::vector<Block>& world) {
+        release();
+        rebuild = false;
+        if (world.empty() || LodDistance <= 0.0f)
+            return;
+        int minX = INT_MAX, minZ = INT_MAX, maxX = INT_MIN, maxZ = INT_MIN;
+        for (const Block& b : world) {
+            int x = regionCoord(b.position.x), z = regionCoord(b.position.z);
+            minX = std::min(minX, x);
+            minZ = std::min(minZ, z);
+            maxX = std::max(maxX, x);
+            maxZ = std::max(maxZ, z);
+        }
+        originX = minX;
+        originZ = minZ;
+        countX = maxX - minX + 1;
+        countZ = maxZ - minZ + 1;
+        regions.resize(countX * countZ);
+        for (Region& r : regions) {
+            r.columns.resize(REGION_SIZE * REGION_SIZE);
+            glGenVertexArrays(LEVELS, r.vao);
+            glGenBuffers(LEVELS, r.vbo);
+            glGenBuffers(LEVELS, r.ebo);
+            for (int l = 0; l < LEVELS; l++) {
+                glBindVertexArray(r.vao[l]);
+                glBindBuffer(GL_ARRAY_BUFFER, r.vbo[l]);
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, r.ebo[l]);
+                // position, texture coords, normal, texture layer, position in the block
+                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, VERTEX_FLOATS * sizeof(float), (void*)0);
+                glEnableVertexAttribArray(0);
+                glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, VERTEX_FLOATS * sizeof(float), (void*)(3 * sizeof(float)));
+                glEnableVertexAttribArray(1);
+                glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, VERTEX_FLOATS * sizeof(float), (void*)(5 * sizeof(float)));
+                glEnableVertexAttribArray(2);
+                glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, VERTEX_FLOATS * sizeof(float), (void*)(8 * sizeof(float)));
+                glEnableVertexAttribArray(3);
+                glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, VERTEX_FLOATS * sizeof(float), (void*)(9 * sizeof(float)));
+                glEnableVertexAttribArray(4);
+            }
+            r.dirty = true;
+        }
+        glBindVertexArray(0);
+        columnMemory.Set((int64_t)(regions.size() * REGION_SIZE * REGION_SIZE * sizeof(Column)));
+    }
+
+    // the block at position was placed or removed; its region, and the one
+    // across if it is on an edge, are rebuilt by the next Update()
+    void Changed(const glm::vec3& position) {
+        if (LodDistance <= 0.0f)
+            return;
+        int x = (int)std::floor(position.x), z = (int)std::floor(position.z);
+        Region* r = region(regionCoord(position.x), regionCoord(position.z));
+        if (r == nullptr) {
+            rebuild = true;     // outside every region; the bounds grow
+            return;
+        }
+        r->dirty = true;
+        for (int dz = -1; dz <= 1; dz++)
+            for (int dx = -1; dx <= 1; dx++) {
+                Region* n = region(regionCoord((float)(x + dx)), regionCoord((float)(z + dz)));
+                if (n != nullptr)
+                    n->dirty = true;
+            }
+    }
+
+    // rebuilds what changed since the last call; call after applying edits
+    void Update(Device& device, const std::vector<Block>& world) {
+        if (rebuild)
+            Build(world);
+        bool any = false;
+        for (Region& r : regions) {
+            if (r.dirty)
+                std::fill(r.columns.begin(), r.columns.end(), Column { INT_MIN, 0 });
+            any = any || r.dirty;
+        }
+        if (!any)
+            return;
+
+        for (const Block& b : world) {
+            Region* r = region(regionCoord(b.position.x), regionCoord(b.position.z));
+            if (r == nullptr || !r->dirty)
+                continue;
+            Column& c = r->columns[columnIndex(b.position.x, b.position.z)];
+            int y = (int)std::floor(b.position.y);
+            if (y > c.top) {
+                c.top = y;
+                c.type = b.bt;
+            }
+        }
+
+        for (int z = 0; z < countZ; z++)
+            for (int x = 0; x < countX; x++) {
+                Region& r = regions[z * countX + x];
+                if (!r.dirty)
+                    continue;
+                for (int l = 0; l < LEVELS; l++) {
+                    mesh(originX + x, originZ + z, 2 << l);
+                    device.BindVertexArray(r.vao[l]);
+                    glBindBuffer(GL_ARRAY_BUFFER, r.vbo[l]);
+                    device.BufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+                    device.BufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+                    r.bytes[l] = (int64_t)(vertices.size() * sizeof(float) + indices.size() * sizeof(GLuint));
+                    r.indices[l] = (int)indices.size();
+                }
+                r.dirty = false;
+            }
+
+        int64_t bytes = 0;
+        for (const Region& r : regions)
+            for (int l = 0; l < LEVELS; l++)
+                bytes += r.bytes[l];
+        bufferMemory.Set(bytes);
+    }
+
+    // picks the level of every region from the eye's distance to its nearest
+    // column; regions wholly beyond viewDistance are not drawn. Returns how
+    // many regions are drawn from downsampled meshes.
+    int Select(const glm::vec3& eye, float viewDistance) {
+        int far = 0;
+        for (int z = 0; z < countZ; z++)
+            for (int x = 0; x < countX; x++) {
+                float minX = (float)((originX + x) * REGION_SIZE), minZ = (float)((originZ + z) * REGION_SIZE);
+                float dx = std::max(std::max(minX - eye.x, eye.x - (minX + REGION_SIZE)), 0.0f);
+                float dz = std::max(std::max(minZ - eye.z, eye.z - (minZ + REGION_SIZE)), 0.0f);
+                float distance = std::sqrt(dx * dx + dz * dz);
+                Region& r = regions[z * countX + x];
+                if (LodDistance <= 0.0f)
+                    r.level = 0;
+                else if (distance > viewDistance)
+                    r.level = -1;
+                else
+                    r.level = std::min(LEVELS, (int)(distance / LodDistance));
+                if (r.level > 0)
+                    far++;
+            }
+        return far;
+    }
+
+    // true if the block at position is drawn as part of a downsampled mesh
+    bool Downsampled(const glm::vec3& position) const {
+        int x = regionCoord(position.x) - originX, z = regionCoord(position.z) - originZ;
+        if (x < 0 || z < 0 || x >= countX || z >= countZ)
+            return false;
+        return regions[z * countX + x].level != 0;
+    }
+
+    // draws the regions Select() put at a downsampled level, with the terrain
+    // shader and block textures bound
+    void Draw(Device& device) const {
+        for (const Region& r : regions) {
+            if (r.level <= 0 || r.indices[r.level - 1] == 0)
+                continue;
+            device.BindVertexArray(r.vao[r.level - 1]);
+            device.DrawElements(GL_TRIANGLES, r.indices[r.level - 1], GL_UNSIGNED_INT, 0);
+        }
+    }
+
+private:
+    static const int VERTEX_FLOATS = 12;
+
+    struct Column {
+        int top;        // height of the highest block, INT_MIN if there is none
+        int type;       // its BlockType
+    };
+
+    struct Region {
+        std::vector<Column> columns;        // REGION_SIZE x REGION_SIZE, x fastest
+        unsigned int vao[LEVELS] = {}, vbo[LEVELS] = {}, ebo[LEVELS] = {};
+        int indices[LEVELS] = {};
+        int64_t bytes[LEVELS] = {};
+        int level = 0;                      // from Select(); 0 block by block, -1 not drawn
+        bool dirty = false;
+    };
+
+    std::vector<Region> regions;
+    int originX = 0, originZ = 0;           // region coordinates of regions[0]
+    int countX = 0, countZ = 0;
+    bool rebuild = false;
+    // mesh being built, kept at its largest size so rebuilds do not allocate
+    std::vector<float> vertices;
+    std::vector<GLuint> indices;
+    MemoryGauge columnMemory { MEMORY_WORLD };
+    MemoryGauge vertexMemory { MEMORY_GEOMETRY };
+    MemoryGauge bufferMemory { MEMORY_GPU_BUFFERS };
+
+    static int regionCoord(float coordinate) {
+        int c = (int)std::floor(coordinate);
+        return c >= 0 ? c / REGION_SIZE : -((-c + REGION_SIZE - 1) / REGION_SIZE);
+    }
+
+    static int columnIndex(float x, float z) {
+        int cx = (int)std::floor(x) & (REGION_SIZE - 1), cz = (int)std::floor(z) & (REGION_SIZE - 1);
+        return cz * REGION_SIZE + cx;
+    }
+
+    Region* region(int x, int z) {
+        x -= originX;
+        z -= originZ;
+        if (x < 0 || z < 0 || x >= countX || z >= countZ)
+            return nullptr;
+        return &regions[z * countX + x];
+    }
+
+    // top of the highest block in the column at world x, z, INT_MIN if empty
+    int surface(int x, int z) {
+        Region* r = region(regionCoord((float)x), regionCoord((float)z));
+        if (r == nullptr)
+            return INT_MIN;
+        const Column& c = r->columns[columnIndex((float)x, (float)z)];
+        return c.top == INT_MIN ? INT_MIN : c.top + 1;
+    }
+
+    // the cell of scale x scale columns at world x, z: false if fewer than
+    // half its columns hold a block
+    bool sample(int x, int z, int scale, int& height, int& type) {
+        const int TYPES = sizeof(BlockTextureLayers) / sizeof(BlockTextureLayers[0]);
+        int counts[TYPES] = {};
+        int present = 0;
+        height = INT_MIN;
+        for (int j = 0; j < scale; j++)
+            for (int i = 0; i < scale; i++) {
+                Region* r = region(regionCoord((float)(x + i)), regionCoord((float)(z + j)));
+                const Column& c = r->columns[columnIndex((float)(x + i), (float)(z + j))];
+                if (c.top == INT_MIN)
+                    continue;
+                present++;
+                height = std::max(height, c.top + 1);
+                counts[c.type]++;
+            }
+        if (present * 2 < scale * scale)
+            return false;
+        type = (int)(std::max_element(counts, counts + TYPES) - counts);
+        return true;
+    }
+
+    // lowest surface of the scale columns across a cell's edge, starting at
+    // world x, z and running along dx, dz; INT_MAX if they are all empty
+    int lowestAcross(int x, int z, int dx, int dz, int scale) {
+        int lowest = INT_MAX;
+        for (int i = 0; i < scale; i++) {
+            int s = surface(x + dx * i, z + dz * i);
+            if (s != INT_MIN)
+                lowest = std::min(lowest, s);
+        }
+        return lowest;
+    }
+
+    void vertex(const glm::vec3& position, const glm::vec2& uv, const glm::vec3& normal, int layer, const glm::vec3& local) {
+        const float v[VERTEX_FLOATS] = { position.x, position.y, position.z, uv.x, uv.y,
+                                         normal.x, normal.y, normal.z, (float)layer, local.x, local.y, local.z };
+        vertices.insert(vertices.end(), v, v + VERTEX_FLOATS);
+    }
+
+    // corners a, b, c, d in order around the quad
+    void quad() {
+        GLuint first = (GLuint)(vertices.size() / VERTEX_FLOATS) - 4;
+        const GLuint q[6] = { first, first + 1, first + 2, first, first + 2, first + 3 };
+        indices.insert(indices.end(), q, q + 6);
+    }
+
+    // a wall on the cell edge from (x0, z0) to (x1, z1), from bottom up to
+    // top, facing normal
+    void wall(float x0, float z0, float x1, float z1, int bottom, int top, const glm::vec3& normal, int layer) {
+        // texture u runs along the edge, v down it, one repeat per block
+        float u0 = normal.x != 0.0f ? z0 : x0, u1 = normal.x != 0.0f ? z1 : x1;
+        // the matching face of a unit block, for lighting
+        glm::vec3 side = normal * 0.5f + glm::vec3(0.5f);
+        glm::vec3 along = normal.x != 0.0f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+        glm::vec3 base = side * (glm::vec3(1.0f) - along) * glm::vec3(1.0f, 0.0f, 1.0f);
+        vertex(glm::vec3(x0, (float)bottom, z0), glm::vec2(u0, (float)-bottom), normal, layer, base);
+        vertex(glm::vec3(x1, (float)bottom, z1), glm::vec2(u1, (float)-bottom), normal, layer, base + along);
+        vertex(glm::vec3(x1, (float)top, z1), glm::vec2(u1, (float)-top), normal, layer, base + along + glm::vec3(0.0f, 1.0f, 0.0f));
+        vertex(glm::vec3(x0, (float)top, z0), glm::vec2(u0, (float)-top), normal, layer, base + glm::vec3(0.0f, 1.0f, 0.0f));
+        quad();
+    }
+
+    // the mesh of the region at region coordinates rx, rz with scale
+    // columns per cell, into vertices and indices
+    void mesh(int rx, int rz, int scale) {
+        vertices.clear();
+        indices.clear();
+        const int cells = REGION_SIZE / scale;
+        const int x0 = rx * REGION_SIZE, z0 = rz * REGION_SIZE;
+        static const int dirs[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+
+        for (int cz = 0; cz < cells; cz++)
+            for (int cx = 0; cx < cells; cx++) {
+                int x = x0 + cx * scale, z = z0 + cz * scale;
+                int height, type;
+                if (!sample(x, z, scale, height, type))
+                    continue;
+                float fx = (float)x, fz = (float)z, fs = (float)scale, fh = (float)height;
+
+                int top = BlockTextureLayers[type][0];
+                vertex(glm::vec3(fx, fh, fz), glm::vec2(fx, fz), glm::vec3(0.0f, 1.0f, 0.0f), top, glm::vec3(0.0f, 1.0f, 0.0f));
+                vertex(glm::vec3(fx + fs, fh, fz), glm::vec2(fx + fs, fz), glm::vec3(0.0f, 1.0f, 0.0f), top, glm::vec3(1.0f, 1.0f, 0.0f));
+                vertex(glm::vec3(fx + fs, fh, fz + fs), glm::vec2(fx + fs, fz + fs), glm::vec3(0.0f, 1.0f, 0.0f), top, glm::vec3(1.0f, 1.0f, 1.0f));
+                vertex(glm::vec3(fx, fh, fz + fs), glm::vec2(fx, fz + fs), glm::vec3(0.0f, 1.0f, 0.0f), top, glm::vec3(0.0f, 1.0f, 1.0f));
+                quad();
+
+                int sideLayer = BlockTextureLayers[type][1];
+                for (int i = 0; i < 4; i++) {
+                    const int* d = dirs[i];
+                    int nx = cx + d[0], nz = cz + d[1];
+                    int bottom;
+                    if (nx >= 0 && nz >= 0 && nx < cells && nz < cells) {
+                        // inside the region: down to the neighbouring cell
+                        int neighbour, neighbourType;
+                        bottom = sample(x + d[0] * scale, z + d[1] * scale, scale, neighbour, neighbourType) ? neighbour : height - scale;
+                    }
+                    else {
+                        // on the edge: a skirt down past whatever is drawn across it
+                        int ex = d[0] > 0 ? x + scale : x - (d[0] < 0 ? 1 : 0);
+                        int ez = d[1] > 0 ? z + scale : z - (d[1] < 0 ? 1 : 0);
+                        bottom = std::min(height - scale, lowestAcross(ex, ez, d[1] != 0 ? 1 : 0, d[0] != 0 ? 1 : 0, scale));
+                    }
+                    if (bottom >= height)
+                        continue;
+                    glm::vec3 normal((float)d[0], 0.0f, (float)d[1]);
+                    float ex0 = d[0] > 0 ? fx + fs : fx, ez0 = d[1] > 0 ? fz + fs : fz;
+                    float ex1 = d[0] != 0 ? ex0 : fx + fs, ez1 = d[1] != 0 ? ez0 : fz + fs;
+                    wall(ex0, ez0, ex1, ez1, bottom, height, normal, sideLayer);
+                }
+            }
+    }
+
+    void release() {
+        for (Region& r : regions) {
+            glDeleteVertexArrays(LEVELS, r.vao);
+            glDeleteBuffers(LEVELS, r.vbo);
+            glDeleteBuffers(LEVELS, r.ebo);
+        }
+        regions.clear();
+        countX = countZ = 0;
+        columnMemory.Set(0);
+        bufferMemory.Set(0);
+    }
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef VIEW_DISTANCE_H
+#define VIEW_DISTANCE_H
+
+#include <vector>
+#include <algorithm>
+
+#include "log/Logger.h"
+
+// Adjusts the view distance (the far plane, and how far away blocks are
+// still drawn) to hold frame time at TargetMs. Frame times are taken in
+// windows of WindowFrames; at the end of each window its Percentile frame
+// time decides. Over the target, the distance shrinks by ShrinkFactor at
+// once. Under LowerBand of the target for GrowWindows windows in a row, it
+// grows by GrowStep. Anywhere between is a dead band where nothing changes,
+// so the distance settles instead of hunting around the target. With
+// Adaptive off the distance stays at MaxDistance.
+class ViewDistanceGovernor {
+public:
+    // Governor options
+    bool Adaptive = true;
+    double TargetMs;
+    float MinDistance = 16.0f;
+    float MaxDistance = 100.0f;
+    int WindowFrames = 30;
+    double Percentile = 90.0;
+    double LowerBand = 0.75;
+    float ShrinkFactor = 0.8f;
+    float GrowStep = 4.0f;
+    int GrowWindows = 3;
+
+    ViewDistanceGovernor(double targetMs = 1000.0 / 60.0) : TargetMs(targetMs) {
+        window.reserve(WindowFrames);
+        distance = MaxDistance;
+    }
+
+    float Distance() const {
+        return Adaptive ? distance : MaxDistance;
+    }
+
+    void Frame(double milliseconds) {
+        if (!Adaptive)
+            return;
+        window.push_back(milliseconds);
+        if ((int)window.size() < WindowFrames)
+            return;
+
+        size_t rank = std::min(window.size() - 1, (size_t)(window.size() * Percentile / 100.0));
+        std::nth_element(window.begin(), window.begin() + rank, window.end());
+        double ms = window[rank];
+        window.clear();
+
+        float next = distance;
+        if (ms > TargetMs) {
+            next = std::max(MinDistance, distance * ShrinkFactor);
+            goodWindows = 0;
+        }
+        else if (ms < TargetMs * LowerBand && ++goodWindows >= GrowWindows) {
+            next = std::min(MaxDistance, distance + GrowStep);
+            goodWindows = 0;
+        }
+        if (next != distance) {
+            LOG_INFO("view distance {} -> {} (p{} frame {} ms, target {} ms)", distance, next, Percentile, ms, TargetMs);
+            distance = next;
+        }
+    }
+
+private:
+    std::vector<double> window;
+    float distance;
+    int goodWindows = 0;
+};
+
+#endif
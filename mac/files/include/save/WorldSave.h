@@ -0,0 +1,477 @@
+#ifndef WORLD_SAVE_H
+#define WORLD_SAVE_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "block/Block.h"
+#include "profile/Profiler.h"
+#include "memory/MemoryTracker.h"
+
+// Incremental world persistence.
+//
+// Every block edit is appended to an in-memory buffer which a background
+// thread writes to a write-ahead log (save/wal.<gen>.log) and fsyncs every
+// syncInterval seconds. Every checkpointInterval seconds the thread rewrites
+// the regions touched since the last checkpoint (save/r.<x>.<z>.bin, one file
+// per REGION_SIZE x REGION_SIZE column) a few at a time, then deletes the logs
+// those regions cover. On startup the regions are loaded and any remaining
+// logs are replayed, so a crash loses at most the last syncInterval of edits.
+//
+// The main thread only ever touches the edit buffer and the shadow copy of
+// the world under a short lock; all file I/O happens on the save thread.
+
+const int REGION_SIZE = 16;
+const int REGIONS_PER_BATCH = 8;
+
+class WorldSave {
+public:
+    // Save options
+    float SyncInterval;
+    float CheckpointInterval;
+
+    WorldSave(const std::string& directory, float syncInterval = 1.0f, float checkpointInterval = 30.0f) : SyncInterval(syncInterval), CheckpointInterval(checkpointInterval), directory(directory) {}
+
+    ~WorldSave() {
+        Stop();
+    }
+
+    // Fills blocks from the region files and replays any logs left behind by a
+    // crash. Returns false if there is no saved world.
+    bool Load(std::vector<Block>& blocks) {
+        mkdir(directory.c_str(), 0755);
+        bool found = false;
+        std::vector<unsigned int> logs;
+        DIR* dir = opendir(directory.c_str());
+        if (dir == NULL)
+            return false;
+        while (dirent* entry = readdir(dir)) {
+            const char* name = entry->d_name;
+            int length = (int)strlen(name);
+            int rx, rz, end = 0;
+            unsigned int gen;
+            // %n only lands at the end of the name if nothing follows the
+            // pattern, so r.X.Z.bin.tmp is not taken for a region
+            if (sscanf(name, "r.%d.%d.bin%n", &rx, &rz, &end) == 2 && end == length) {
+                loadRegion(directory + "/" + name);
+                found = true;
+                continue;
+            }
+            end = 0;
+            if (sscanf(name, "wal.%u.log%n", &gen, &end) == 1 && end == length)
+                logs.push_back(gen);
+            else if (length > 4 && strcmp(name + length - 4, ".tmp") == 0)
+                unlink((directory + "/" + name).c_str());   // a region write cut short by a crash
+        }
+        closedir(dir);
+
+        std::sort(logs.begin(), logs.end());
+        for (unsigned int gen : logs) {
+            replayLog(gen);
+            liveLogs.push_back(gen);
+            generation = gen + 1;
+            found = true;
+        }
+        if (!logs.empty())
+            std::cout << "Recovered " << logs.size() << " world log(s)" << std::endl;
+
+        blocks.clear();
+        for (auto& region : shadow) {
+            for (auto& entry : region.second)
+                blocks.emplace_back(unpackPosition(entry.first), (BlockType)entry.second.bt, entry.second.solid);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        accountMemory();
+        return found;
+    }
+
+    // Starts the save thread. Regions without a file on disk yet (a freshly
+    // generated world) are written first, before the first log exists, so a
+    // crash can never leave a log behind without the world it applies to.
+    void Start(const std::vector<Block>& blocks) {
+        if (running)
+            return;
+        std::unordered_set<long long> unsaved;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const Block& b : blocks) {
+                long long region = regionKey(b.position);
+                if (shadow.find(region) == shadow.end())
+                    unsaved.insert(region);
+            }
+            for (const Block& b : blocks) {
+                long long region = regionKey(b.position);
+                if (unsaved.count(region))
+                    shadow[region][packPosition(b.position)] = { (uint8_t)b.bt, b.isSolid };
+            }
+            pending.reserve(1024);
+            accountMemory();
+        }
+        // the save thread is not running yet, so the shadow needs no lock
+        std::vector<RegionRecord> contents;
+        for (long long region : unsaved) {
+            contents.clear();
+            collectRegion(region, contents);
+            writeRegion((int)(region >> 32), (int)(region & 0xffffffff), contents);
+        }
+        if (!unsaved.empty())
+            syncDirectory();
+        logFd = openLog(generation);
+        liveLogs.push_back(generation);
+        running = true;
+        worker = std::thread(&WorldSave::run, this);
+    }
+
+    bool Running() const {
+        return running;
+    }
+
+    // Flushes the log, writes a final checkpoint and joins the save thread.
+    void Stop() {
+        if (!running)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        wake.notify_one();
+        worker.join();
+        syncLog();
+        checkpoint();
+        close(logFd);
+        logFd = -1;
+    }
+
+    void RecordPlace(const Block& block) {
+        record(OP_PLACE, block);
+    }
+
+    void RecordDestroy(const Block& block) {
+        record(OP_DESTROY, block);
+    }
+
+private:
+    enum LogOp : uint8_t {
+        OP_PLACE = 1,
+        OP_DESTROY = 2
+    };
+
+    struct LogRecord {
+        uint8_t op;
+        uint8_t bt;
+        uint8_t solid;
+        uint8_t check;
+        int32_t x, y, z;
+    };
+
+    struct SavedBlock {
+        uint8_t bt;
+        bool solid;
+    };
+
+    struct RegionRecord {
+        int32_t x, y, z;
+        uint8_t bt;
+        uint8_t solid;
+        uint8_t pad[2];
+    };
+
+    static const uint32_t REGION_MAGIC = 0x47524f47; // "GORG"
+    static const uint32_t REGION_VERSION = 1;
+
+    std::string directory;
+    std::unordered_map<long long, std::unordered_map<long long, SavedBlock>> shadow;
+    std::unordered_set<long long> dirty;
+    std::vector<LogRecord> pending;
+    std::vector<unsigned int> liveLogs;
+    unsigned int generation = 0;
+    int logFd = -1;
+    bool running = false;
+    std::thread worker;
+    std::mutex mutex;
+    std::mutex ioMutex;
+    std::condition_variable wake;
+    MemoryGauge shadowMemory { MEMORY_WORLD };
+    MemoryGauge pendingMemory { MEMORY_IO };
+
+    void record(LogOp op, const Block& block) {
+        LogRecord r;
+        r.op = op;
+        r.bt = (uint8_t)block.bt;
+        r.solid = block.isSolid;
+        r.x = (int32_t)floor(block.position.x);
+        r.y = (int32_t)floor(block.position.y);
+        r.z = (int32_t)floor(block.position.z);
+        r.check = checksum(r);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(r);
+        apply(r);
+        accountMemory();
+    }
+
+    // report the shadow world (estimating each hash node as its entry plus
+    // two pointers) and the edit buffer; mutex must be held
+    void accountMemory() {
+        size_t entries = 0;
+        for (auto& region : shadow)
+            entries += region.second.size();
+        shadowMemory.Set((int64_t)(entries * (sizeof(std::pair<const long long, SavedBlock>) + 2 * sizeof(void*))));
+        pendingMemory.Set((int64_t)(pending.capacity() * sizeof(LogRecord)));
+    }
+
+    void run() {
+        Profiler::Get().SetThreadName("world save");
+        auto lastCheckpoint = std::chrono::steady_clock::now() - std::chrono::duration<float>(CheckpointInterval);
+        std::unique_lock<std::mutex> lock(mutex);
+        while (running) {
+            wake.wait_for(lock, std::chrono::duration<float>(SyncInterval));
+            if (!running)
+                break;
+            lock.unlock();
+            syncLog();
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastCheckpoint >= std::chrono::duration<float>(CheckpointInterval)) {
+                checkpoint();
+                lastCheckpoint = now;
+            }
+            lock.lock();
+        }
+    }
+
+    // write buffered edits to the current log and make them durable
+    void syncLog() {
+        PROFILE_SCOPE("save sync");
+        std::lock_guard<std::mutex> io(ioMutex);
+        std::vector<LogRecord> batch;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (pending.empty())
+                return;
+            batch.swap(pending);
+            pending.reserve(batch.capacity());
+            accountMemory();
+        }
+        writeAll(logFd, batch.data(), batch.size() * sizeof(LogRecord));
+        fsync(logFd);
+    }
+
+    // rewrite dirty regions, then retire the logs they cover
+    void checkpoint() {
+        PROFILE_SCOPE("save checkpoint");
+        std::lock_guard<std::mutex> io(ioMutex);
+        std::vector<long long> regions;
+        std::vector<LogRecord> batch;
+        std::vector<unsigned int> retired;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (dirty.empty()) {
+                // everything is already in the region files
+                for (size_t i = 0; i + 1 < liveLogs.size(); i++)
+                    unlink(logPath(liveLogs[i]).c_str());
+                liveLogs.erase(liveLogs.begin(), liveLogs.end() - 1);
+                return;
+            }
+            regions.assign(dirty.begin(), dirty.end());
+            dirty.clear();
+            batch.swap(pending);
+            accountMemory();
+        }
+        // edits made from here on go to a fresh log that survives this checkpoint
+        writeAll(logFd, batch.data(), batch.size() * sizeof(LogRecord));
+        fsync(logFd);
+        close(logFd);
+        retired.swap(liveLogs);
+        logFd = openLog(++generation);
+        liveLogs.push_back(generation);
+
+        std::vector<RegionRecord> contents;
+        for (size_t i = 0; i < regions.size(); i++) {
+            int rx = (int)(regions[i] >> 32);
+            int rz = (int)(regions[i] & 0xffffffff);
+            contents.clear();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                collectRegion(regions[i], contents);
+            }
+            writeRegion(rx, rz, contents);
+            if ((i + 1) % REGIONS_PER_BATCH == 0)
+                std::this_thread::yield();
+        }
+        syncDirectory();
+        for (unsigned int gen : retired)
+            unlink(logPath(gen).c_str());
+    }
+
+    // update the shadow copy of the world with one edit
+    void apply(const LogRecord& r) {
+        glm::vec3 pos(r.x, r.y, r.z);
+        long long region = regionKey(pos);
+        if (r.op == OP_PLACE)
+            shadow[region][packPosition(pos)] = { r.bt, r.solid != 0 };
+        else
+            shadow[region].erase(packPosition(pos));
+        dirty.insert(region);
+    }
+
+    void collectRegion(long long region, std::vector<RegionRecord>& contents) {
+        auto it = shadow.find(region);
+        if (it == shadow.end())
+            return;
+        for (auto& entry : it->second) {
+            glm::vec3 pos = unpackPosition(entry.first);
+            RegionRecord r;
+            r.x = (int32_t)pos.x;
+            r.y = (int32_t)pos.y;
+            r.z = (int32_t)pos.z;
+            r.bt = entry.second.bt;
+            r.solid = entry.second.solid;
+            r.pad[0] = r.pad[1] = 0;
+            contents.push_back(r);
+        }
+    }
+
+    void writeRegion(int rx, int rz, const std::vector<RegionRecord>& contents) {
+        std::string path = regionPath(rx, rz);
+        if (contents.empty()) {
+            unlink(path.c_str());
+            return;
+        }
+        std::string tmp = path + ".tmp";
+        int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            std::cout << "ERROR::SAVE::REGION_NOT_WRITTEN " << path << std::endl;
+            return;
+        }
+        uint32_t header[3] = { REGION_MAGIC, REGION_VERSION, (uint32_t)contents.size() };
+        writeAll(fd, header, sizeof(header));
+        writeAll(fd, contents.data(), contents.size() * sizeof(RegionRecord));
+        fsync(fd);
+        close(fd);
+        rename(tmp.c_str(), path.c_str());
+    }
+
+    void loadRegion(const std::string& path) {
+        FILE* f = fopen(path.c_str(), "rb");
+        if (f == NULL)
+            return;
+        uint32_t header[3];
+        if (fread(header, sizeof(header), 1, f) == 1 && header[0] == REGION_MAGIC && header[1] == REGION_VERSION) {
+            std::vector<RegionRecord> contents(header[2]);
+            size_t n = fread(contents.data(), sizeof(RegionRecord), contents.size(), f);
+            for (size_t i = 0; i < n; i++) {
+                glm::vec3 pos(contents[i].x, contents[i].y, contents[i].z);
+                shadow[regionKey(pos)][packPosition(pos)] = { contents[i].bt, contents[i].solid != 0 };
+            }
+        }
+        else {
+            std::cout << "ERROR::SAVE::BAD_REGION " << path << std::endl;
+        }
+        fclose(f);
+    }
+
+    // apply a log's edits on top of the loaded regions; a torn record at the
+    // end (crash mid-write) stops the replay
+    void replayLog(unsigned int gen) {
+        FILE* f = fopen(logPath(gen).c_str(), "rb");
+        if (f == NULL)
+            return;
+        LogRecord r;
+        while (fread(&r, sizeof(r), 1, f) == 1) {
+            if (r.check != checksum(r) || (r.op != OP_PLACE && r.op != OP_DESTROY))
+                break;
+            apply(r);
+        }
+        fclose(f);
+    }
+
+    int openLog(unsigned int gen) {
+        int fd = open(logPath(gen).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0)
+            std::cout << "ERROR::SAVE::LOG_NOT_OPENED " << logPath(gen) << std::endl;
+        return fd;
+    }
+
+    void syncDirectory() {
+        int fd = open(directory.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            fsync(fd);
+            close(fd);
+        }
+    }
+
+    static void writeAll(int fd, const void* data, size_t size) {
+        const char* p = (const char*)data;
+        while (fd >= 0 && size > 0) {
+            ssize_t n = write(fd, p, size);
+            if (n <= 0)
+                return;
+            p += n;
+            size -= n;
+        }
+    }
+
+    std::string logPath(unsigned int gen) const {
+        return directory + "/wal." + std::to_string(gen) + ".log";
+    }
+
+    std::string regionPath(int rx, int rz) const {
+        return directory + "/r." + std::to_string(rx) + "." + std::to_string(rz) + ".bin";
+    }
+
+    static uint8_t checksum(const LogRecord& r) {
+        const uint8_t* p = (const uint8_t*)&r;
+        uint8_t sum = 0x5a;
+        for (size_t i = 0; i < sizeof(LogRecord); i++) {
+            if (i != offsetof(LogRecord, check))
+                sum = (uint8_t)((sum << 1 | sum >> 7) ^ p[i]);
+        }
+        return sum;
+    }
+
+    static long long packPosition(const glm::vec3& pos) {
+        long long x = (long long)floor(pos.x) & 0x1fffff;
+        long long y = (long long)floor(pos.y) & 0x1fffff;
+        long long z = (long long)floor(pos.z) & 0x1fffff;
+        return (x << 42) | (y << 21) | z;
+    }
+
+    static glm::vec3 unpackPosition(long long key) {
+        // sign-extend each 21-bit field
+        int x = (int)((key >> 42) & 0x1fffff);
+        int y = (int)((key >> 21) & 0x1fffff);
+        int z = (int)(key & 0x1fffff);
+        x = (x ^ 0x100000) - 0x100000;
+        y = (y ^ 0x100000) - 0x100000;
+        z = (z ^ 0x100000) - 0x100000;
+        return glm::vec3(x, y, z);
+    }
+
+    static long long regionKey(const glm::vec3& pos) {
+        long long rx = (long long)floor(pos.x / REGION_SIZE);
+        long long rz = (long long)floor(pos.z / REGION_SIZE);
+        return (rx << 32) | (rz & 0xffffffff);
+    }
+};
+
+#endif
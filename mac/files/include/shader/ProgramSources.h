@@ -0,0 +1,48 @@
+#ifndef PROGRAM_SOURCES_H
+#define PROGRAM_SOURCES_H
+
+#include <glad/glad.h>
+
+#include <map>
+#include <string>
+
+// The final GLSL every program was linked from, after ShaderVariants has put
+// its defines and includes in, whether or not the shader cache had the
+// binary. Captures (render/CaptureDevice.h) store these so a replay can
+// compile on any driver. Filled by Shader::startCompile on the render thread.
+class ProgramSources {
+public:
+    struct Sources {
+        std::string Vertex;
+        std::string Fragment;
+        std::string Geometry;       // empty without a geometry shader
+    };
+
+    static ProgramSources& Instance() {
+        static ProgramSources sources;
+        return sources;
+    }
+
+    // code need not be null-terminated; geometry may be nullptr
+    void Set(unsigned int program, const char* vertex, GLint vertexLength, const char* fragment, GLint fragmentLength,
+             const char* geometry, GLint geometryLength) {
+        Sources& s = programs[program];
+        s.Vertex.assign(vertex, vertexLength);
+        s.Fragment.assign(fragment, fragmentLength);
+        if (geometry != nullptr)
+            s.Geometry.assign(geometry, geometryLength);
+        else
+            s.Geometry.clear();
+    }
+
+    // nullptr for a program not built by Shader
+    const Sources* Find(unsigned int program) const {
+        auto it = programs.find(program);
+        return it != programs.end() ? &it->second : nullptr;
+    }
+
+private:
+    std::map<unsigned int, Sources> programs;
+};
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+
+#include <sys/stat.h>
+
+// the loader only covers GL 3.3 core; program binaries come from
+// ARB_get_program_binary (core in 4.1) and are fetched by hand in Init()
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+// On-disk cache of linked shader programs.
+//
+// Programs are keyed by a hash of their sources plus the GL vendor, renderer
+// and version strings, so a driver update simply misses. A binary the driver
+// refuses is deleted and the program is compiled from source again.
+class ShaderCache {
+public:
+    // Cache statistics
+    int Hits = 0;
+    int Misses = 0;
+    int Rejected = 0;
+    double Milliseconds = 0.0;   // time spent building programs, cached or not
+
+    ShaderCache(const std::string& directory) : directory(directory) {}
+
+    // must be called with a current context; returns false when the driver
+    // has no program binary support, in which case every lookup misses
+    bool Init(GLADloadproc load) {
+        getProgramBinary = (GetProgramBinaryFn)load("glGetProgramBinary");
+        programBinary = (ProgramBinaryFn)load("glProgramBinary");
+        programParameteri = (ProgramParameteriFn)load("glProgramParameteri");
+        GLint formats = 0;
+        if (getProgramBinary != nullptr && programBinary != nullptr)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        enabled = formats > 0;
+        if (!enabled)
+            return false;
+
+        driverKey = hash(0xcbf29ce484222325ULL, (const char*)glGetString(GL_VENDOR));
+        driverKey = hash(driverKey, (const char*)glGetString(GL_RENDERER));
+        driverKey = hash(driverKey, (const char*)glGetString(GL_VERSION));
+        mkdir(directory.c_str(), 0755);
+        return true;
+    }
+
+    bool Enabled() const {
+        return enabled;
+    }
+
+    // key for a program built from the given stages (null stages are skipped)
+    uint64_t Key(const char* vertex, GLint vLength, const char* fragment, GLint fLength, const char* geometry, GLint gLength) const {
+        uint64_t key = hash(driverKey, vertex, vLength);
+        key = hash(key, fragment, fLength);
+        if (geometry != nullptr)
+            key = hash(key, geometry, gLength);
+        return key;
+    }
+
+    // try to fill program from the cache; counts a hit or a miss
+    bool Load(uint64_t key, GLuint program) {
+        if (!enabled) {
+            Misses++;
+            return false;
+        }
+        FILE* f = fopen(path(key).c_str(), "rb");
+        if (f == NULL) {
+            Misses++;
+            return false;
+        }
+        uint32_t header[3];
+        std::vector<char> binary;
+        bool read = fread(header, sizeof(header), 1, f) == 1 && header[0] == CACHE_MAGIC;
+        if (read) {
+            binary.resize(header[2]);
+            read = fread(binary.data(), 1, binary.size(), f) == binary.size();
+        }
+        fclose(f);
+
+        GLint success = 0;
+        if (read) {
+            programBinary(program, header[1], binary.data(), (GLsizei)binary.size());
+            glGetProgramiv(program, GL_LINK_STATUS, &success);
+        }
+        if (!success) {
+            remove(path(key).c_str());
+            Rejected++;
+            Misses++;
+            return false;
+        }
+        Hits++;
+        return true;
+    }
+
+    // call before glLinkProgram so the driver keeps the binary around
+    void PrepareLink(GLuint program) const {
+        if (enabled && programParameteri != nullptr)
+            programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // write a successfully linked program to the cache
+    void Store(uint64_t key, GLuint program) const {
+        if (!enabled)
+            return;
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        getProgramBinary(program, length, &length, &format, binary.data());
+
+        std::string tmp = path(key) + ".tmp";
+        FILE* f = fopen(tmp.c_str(), "wb");
+        if (f == NULL)
+            return;
+        uint32_t header[3] = { CACHE_MAGIC, format, (uint32_t)length };
+        bool written = fwrite(header, sizeof(header), 1, f) == 1 && fwrite(binary.data(), 1, length, f) == (size_t)length;
+        fclose(f);
+        if (written)
+            rename(tmp.c_str(), path(key).c_str());
+        else
+            remove(tmp.c_str());
+    }
+
+    void Report() const {
+        std::cout << "shader cache: " << Hits << " hits, " << Misses << " misses";
+        if (Rejected > 0)
+            std::cout << " (" << Rejected << " rejected)";
+        if (!enabled)
+            std::cout << " (unsupported by driver)";
+        std::cout << ", " << Milliseconds << " ms building programs" << std::endl;
+    }
+
+private:
+    typedef void (APIENTRYP GetProgramBinaryFn)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+    typedef void (APIENTRYP ProgramBinaryFn)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+    typedef void (APIENTRYP ProgramParameteriFn)(GLuint program, GLenum pname, GLint value);
+
+    static const uint32_t CACHE_MAGIC = 0x4843474f; // "OGCH"
+
+    std::string directory;
+    bool enabled = false;
+    uint64_t driverKey = 0;
+    GetProgramBinaryFn getProgramBinary = nullptr;
+    ProgramBinaryFn programBinary = nullptr;
+    ProgramParameteriFn programParameteri = nullptr;
+
+    std::string path(uint64_t key) const {
+        char name[32];
+        snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+        return directory + name;
+    }
+
+    // FNV-1a
+    static uint64_t hash(uint64_t h, const char* data, GLint length = -1) {
+        if (data == nullptr)
+            return h;
+        for (GLint i = 0; length < 0 ? data[i] != '\0' : i < length; i++) {
+            h ^= (unsigned char)data[i];
+            h *= 0x100000001b3ULL;
+        }
+        // separate consecutive strings
+        h ^= 0xff;
+        h *= 0x100000001b3ULL;
+        return h;
+    }
+};
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <iostream>
+
+#include "shader/shader_s.h"
+#include "shader/ShaderCache.h"
+#include "asset/AssetPack.h"
+
+// Expands '#include "file"' directives (relative to the including file,
+// each file pasted at most once) and injects '#define' lines for the
+// requested features right after the '#version' line. Shaders use
+// '#ifdef FEATURE' instead of runtime branches, so a disabled feature is
+// not in the compiled program at all.
+inline bool expandShaderSource(const AssetPack& assets, const std::string& name, std::string& out, std::set<std::string>& included, int depth = 0)
+{
+    if (depth > 16)
+    {
+        std::cout << "ERROR::SHADER::INCLUDE_TOO_DEEP " << name << std::endl;
+        return false;
+    }
+    if (!included.insert(name).second)
+        return true;
+    AssetView file = assets.Get(name);
+    if (!file.valid())
+        return false;
+    std::string directory = name.substr(0, name.find_last_of('/') + 1);
+    int fileNumber = (int)included.size() - 1;
+    if (depth > 0)
+        out += "#line 1 " + std::to_string(fileNumber) + "\n";
+
+    size_t pos = 0;
+    int line = 1;
+    std::string text(file.text(), file.size);
+    while (pos < text.size())
+    {
+        size_t end = text.find('\n', pos);
+        if (end == std::string::npos)
+            end = text.size();
+        std::string current = text.substr(pos, end - pos);
+        size_t first = current.find_first_not_of(" \t");
+        if (first != std::string::npos && current.compare(first, 8, "#include") == 0)
+        {
+            size_t open = current.find('"', first);
+            size_t close = current.find('"', open + 1);
+            if (open == std::string::npos || close == std::string::npos)
+            {
+                std::cout << "ERROR::SHADER::BAD_INCLUDE " << name << ":" << line << std::endl;
+                return false;
+            }
+            if (!expandShaderSource(assets, directory + current.substr(open + 1, close - open - 1), out, included, depth + 1))
+                return false;
+            // keep compiler messages pointing at the right file and line
+            out += "#line " + std::to_string(line + 1) + " " + std::to_string(fileNumber) + "\n";
+        }
+        else
+        {
+            out += current;
+            out += '\n';
+        }
+        pos = end + 1;
+        line++;
+    }
+    return true;
+}
+
+inline std::string preprocessShader(const AssetPack& assets, const std::string& name, const std::vector<std::string>& defines)
+{
+    std::string expanded;
+    std::set<std::string> included;
+    if (!expandShaderSource(assets, name, expanded, included))
+        return std::string();
+
+    // '#version' has to stay the first statement, so defines go after it
+    size_t insert = 0;
+    size_t version = expanded.find("#version");
+    if (version != std::string::npos)
+        insert = expanded.find('\n', version) + 1;
+    std::string header;
+    for (const std::string& define : defines)
+        header += "#define " + define + "\n";
+    header += "#line 2 0\n";
+    expanded.insert(insert, header);
+    return expanded;
+}
+
+// All compile-time permutations of one vertex/fragment pair.
+//
+// Each entry of features is a preprocessor symbol; a variant key is a bit
+// mask over that list (bit i set = features[i] defined). Build() compiles
+// the variants a scene needs up front, and Get() returns the specialized
+// program for a key.
+class ShaderVariants {
+public:
+    ShaderVariants(const AssetPack& assets, const std::string& vertexName, const std::string& fragmentName, const std::vector<std::string>& features, ShaderCache* cache = nullptr)
+        : assets(assets), vertexName(vertexName), fragmentName(fragmentName), features(features), cache(cache) {}
+
+    // key with the named features switched on
+    unsigned int Key(const std::vector<std::string>& enabled) const {
+        unsigned int key = 0;
+        for (const std::string& name : enabled) {
+            for (size_t i = 0; i < features.size(); i++) {
+                if (features[i] == name)
+                    key |= 1u << i;
+            }
+        }
+        return key;
+    }
+
+    // compile every listed variant, queueing all of them with the driver
+    // before waiting on any
+    void Build(const std::vector<unsigned int>& keys) {
+        std::vector<unsigned int> started;
+        for (unsigned int key : keys) {
+            if (programs.count(key))
+                continue;
+            std::vector<std::string> defines;
+            for (size_t i = 0; i < features.size(); i++) {
+                if (key & (1u << i))
+                    defines.push_back(features[i]);
+            }
+            std::string vertex = preprocessShader(assets, vertexName, defines);
+            std::string fragment = preprocessShader(assets, fragmentName, defines);
+            programs[key].startCompile(vertex.c_str(), (GLint)vertex.size(), fragment.c_str(), (GLint)fragment.size(), nullptr, 0, cache);
+            started.push_back(key);
+        }
+        for (unsigned int key : started)
+            programs[key].finishCompile();
+    }
+
+    // the program for key; built on demand if Build() did not cover it
+    Shader& Get(unsigned int key) {
+        if (!programs.count(key))
+            Build(std::vector<unsigned int>(1, key));
+        return programs[key];
+    }
+
+    // let the driver use as many compiler threads as it likes
+    // (KHR_parallel_shader_compile); a no-op everywhere else
+    static void EnableParallelCompile(GLADloadproc load) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++) {
+            const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+            if (name != nullptr && std::string(name) == "GL_KHR_parallel_shader_compile") {
+                typedef void (APIENTRYP MaxShaderCompilerThreadsFn)(GLuint count);
+                MaxShaderCompilerThreadsFn maxThreads = (MaxShaderCompilerThreadsFn)load("glMaxShaderCompilerThreadsKHR");
+                if (maxThreads != nullptr)
+                    maxThreads(0xffffffff);
+                return;
+            }
+        }
+    }
+
+private:
+    const AssetPack& assets;
+    std::string vertexName;
+    std::string fragmentName;
+    std::vector<std::string> features;
+    ShaderCache* cache;
+    std::map<unsigned int, Shader> programs;
+};
+
+#endif
@@ -8,14 +8,22 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <chrono>
+
+#include "shader/ShaderCache.h"
+#include "shader/ProgramSources.h"
+#include "render/GlDevice.h"
+#include "log/Logger.h"
 
 class Shader
 {
 public:
     unsigned int ID;
+    // where use() and the uniform setters go; only compiling talks to GL directly
+    Device* device = &GlDevice::Instance();
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, ShaderCache* cache = nullptr)
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
@@ -55,116 +63,196 @@ public:
         }
         catch (std::ifstream::failure& e)
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+            LOG_ERROR("ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ");
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
         // 2. compile shaders
-        unsigned int vertex, fragment;
+        compile(vertexCode.c_str(), (GLint)vertexCode.size(), fragmentCode.c_str(), (GLint)fragmentCode.size(),
+                geometryPath != nullptr ? geometryCode.c_str() : nullptr, (GLint)geometryCode.size(), cache);
+    }
+    // constructor for source already in memory (e.g. an asset pack view); the
+    // code does not need to be null-terminated
+    // ------------------------------------------------------------------------
+    Shader(const char* vertexCode, GLint vertexLength, const char* fragmentCode, GLint fragmentLength, const char* geometryCode = nullptr, GLint geometryLength = 0, ShaderCache* cache = nullptr)
+    {
+        compile(vertexCode, vertexLength, fragmentCode, fragmentLength, geometryCode, geometryLength, cache);
+    }
+    // empty shader to be built with startCompile()/finishCompile()
+    // ------------------------------------------------------------------------
+    Shader() : ID(0) {}
+    // two-phase build: startCompile() hands the sources to the driver (or
+    // fetches the program from the cache) without waiting on the result, and
+    // finishCompile() checks it. Starting several programs before finishing
+    // any lets drivers with parallel shader compilation overlap them.
+    // ------------------------------------------------------------------------
+    void startCompile(const char* vShaderCode, GLint vLength, const char* fShaderCode, GLint fLength, const char* gShaderCode, GLint gLength, ShaderCache* cache)
+    {
+        auto start = std::chrono::steady_clock::now();
+        pendingCache = cache;
+        if (cache != nullptr)
+        {
+            pendingKey = cache->Key(vShaderCode, vLength, fShaderCode, fLength, gShaderCode, gLength);
+            ID = glCreateProgram();
+            bool hit = cache->Load(pendingKey, ID);
+            if (!hit)
+                glDeleteProgram(ID);
+            cache->Milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (hit)
+            {
+                ProgramSources::Instance().Set(ID, vShaderCode, vLength, fShaderCode, fLength, gShaderCode, gLength);
+                pendingCache = nullptr;
+                return;
+            }
+            start = std::chrono::steady_clock::now();
+        }
         // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
+        pendingVertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(pendingVertex, 1, &vShaderCode, &vLength);
+        glCompileShader(pendingVertex);
         // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
+        pendingFragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(pendingFragment, 1, &fShaderCode, &fLength);
+        glCompileShader(pendingFragment);
         // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
-        if(geometryPath != nullptr)
+        if(gShaderCode != nullptr)
         {
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            pendingGeometry = glCreateShader(GL_GEOMETRY_SHADER);
+            glShaderSource(pendingGeometry, 1, &gShaderCode, &gLength);
+            glCompileShader(pendingGeometry);
         }
         // shader Program
         ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
-            glAttachShader(ID, geometry);
+        glAttachShader(ID, pendingVertex);
+        glAttachShader(ID, pendingFragment);
+        if(pendingGeometry != 0)
+            glAttachShader(ID, pendingGeometry);
+        if(cache != nullptr)
+            cache->PrepareLink(ID);
         glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
+        ProgramSources::Instance().Set(ID, vShaderCode, vLength, fShaderCode, fLength, gShaderCode, gLength);
+        if(cache != nullptr)
+            cache->Milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    void finishCompile()
+    {
+        if (pendingVertex == 0)
+            return;
+        auto start = std::chrono::steady_clock::now();
+        checkCompileErrors(pendingVertex, "VERTEX");
+        checkCompileErrors(pendingFragment, "FRAGMENT");
+        if(pendingGeometry != 0)
+            checkCompileErrors(pendingGeometry, "GEOMETRY");
+        if(checkCompileErrors(ID, "PROGRAM") && pendingCache != nullptr)
+            pendingCache->Store(pendingKey, ID);
         // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
-
+        glDeleteShader(pendingVertex);
+        glDeleteShader(pendingFragment);
+        if(pendingGeometry != 0)
+            glDeleteShader(pendingGeometry);
+        pendingVertex = pendingFragment = pendingGeometry = 0;
+        if(pendingCache != nullptr)
+            pendingCache->Milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        pendingCache = nullptr;
     }
     // activate the shader
     // ------------------------------------------------------------------------
     void use()
     {
-        glUseProgram(ID);
+        device->UseProgram(ID);
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        int v = (int)value;
+        device->UniformInts(location(name), 1, &v);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        device->UniformInts(location(name), 1, &value);
+    }
+    // ------------------------------------------------------------------------
+    void setIVec2(const std::string &name, int x, int y) const
+    {
+        int v[2] = { x, y };
+        device->UniformInts(location(name), 2, v);
+    }
+    // ------------------------------------------------------------------------
+    void setIVec3(const std::string &name, int x, int y, int z) const
+    {
+        int v[3] = { x, y, z };
+        device->UniformInts(location(name), 3, v);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        device->UniformFloats(location(name), 1, &value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        device->UniformFloats(location(name), 2, &value[0]);
     }
     void setVec2(const std::string &name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        float v[2] = { x, y };
+        device->UniformFloats(location(name), 2, v);
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        device->UniformFloats(location(name), 3, &value[0]);
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        float v[3] = { x, y, z };
+        device->UniformFloats(location(name), 3, v);
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        device->UniformFloats(location(name), 4, &value[0]);
     }
     void setVec4(const std::string &name, float x, float y, float z, float w)
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        float v[4] = { x, y, z, w };
+        device->UniformFloats(location(name), 4, v);
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        device->UniformMatrix(location(name), 2, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        device->UniformMatrix(location(name), 3, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        device->UniformMatrix(location(name), 4, &mat[0][0]);
     }
 
 private:
+    // program being built by startCompile()
+    unsigned int pendingVertex = 0, pendingFragment = 0, pendingGeometry = 0;
+    uint64_t pendingKey = 0;
+    ShaderCache* pendingCache = nullptr;
+
+    int location(const std::string &name) const
+    {
+        return device->UniformLocation(ID, name.c_str());
+    }
+
+    void compile(const char* vShaderCode, GLint vLength, const char* fShaderCode, GLint fLength, const char* gShaderCode, GLint gLength, ShaderCache* cache)
+    {
+        startCompile(vShaderCode, vLength, fShaderCode, fLength, gShaderCode, gLength, cache);
+        finishCompile();
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -174,7 +262,7 @@ private:
             if(!success)
             {
                 glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+                LOG_ERROR("ERROR::SHADER_COMPILATION_ERROR of type: {}\n{}\n -- --------------------------------------------------- -- ", type, infoLog);
             }
         }
         else
@@ -183,9 +271,10 @@ private:
             if(!success)
             {
                 glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+                LOG_ERROR("ERROR::PROGRAM_LINKING_ERROR of type: {}\n{}\n -- --------------------------------------------------- -- ", type, infoLog);
             }
         }
+        return success;
     }
 };
 #endif
@@ -0,0 +1,62 @@
+#ifndef FIXED_TIMESTEP_H
+#define FIXED_TIMESTEP_H
+
+#include <cmath>
+#include <cstdint>
+
+// Fixed-rate simulation clock. Each frame Advance() adds the frame's elapsed
+// time to an accumulator and returns how many whole ticks of 1 / TickRate
+// seconds to run, so physics steps the same way at any frame rate. A frame
+// runs at most MaxTicks; time beyond that is dropped, so a slow frame cannot
+// make the next one slower still. Alpha() is how far the clock is into the
+// next tick, for interpolating what is drawn between the last two ticks.
+class FixedTimestep {
+public:
+    // Timestep options
+    double TickRate;
+    int MaxTicks;
+
+    FixedTimestep(double tickRate = 60.0, int maxTicks = 5) : TickRate(tickRate), MaxTicks(maxTicks) {}
+
+    float Tick() const {
+        return (float)(1.0 / TickRate);
+    }
+
+    int Advance(double seconds) {
+        double tick = 1.0 / TickRate;
+        accumulator += seconds > 0.0 ? seconds : 0.0;
+        int ticks = (int)(accumulator / tick);
+        if (ticks > MaxTicks) {
+            dropped += (uint64_t)(ticks - MaxTicks);
+            ticks = MaxTicks;
+            accumulator = std::fmod(accumulator, tick);
+        }
+        else {
+            accumulator -= ticks * tick;
+        }
+        total += (uint64_t)ticks;
+        return ticks;
+    }
+
+    // 0 just after a tick, approaching 1 just before the next
+    float Alpha() const {
+        float alpha = (float)(accumulator * TickRate);
+        return alpha < 0.0f ? 0.0f : (alpha > 1.0f ? 1.0f : alpha);
+    }
+
+    uint64_t Ticks() const {
+        return total;
+    }
+
+    // ticks skipped because a frame hit MaxTicks
+    uint64_t DroppedTicks() const {
+        return dropped;
+    }
+
+private:
+    double accumulator = 0.0;
+    uint64_t total = 0;
+    uint64_t dropped = 0;
+};
+
+#endif
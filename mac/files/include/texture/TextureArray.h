@@ -0,0 +1,63 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+#include "asset/AssetPack.h"
+
+// S3TC formats (EXT_texture_compression_s3tc), not part of the 3.3 loader
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// Block-compressed layered texture written by tools/bake_textures.
+//
+// Layout: a TextureArrayHeader, then one uint32 byte count per mip level,
+// then the levels from largest to smallest. Each level holds every layer
+// back to back, which is exactly what glCompressedTexImage3D takes, so the
+// levels are uploaded as they are, with no decoding; see
+// TextureLoader::LoadTextureArray.
+
+const uint32_t TEXTURE_ARRAY_MAGIC = 0x4154474f; // "OGTA"
+const uint32_t TEXTURE_ARRAY_VERSION = 1;
+
+struct TextureArrayHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;     // GL_COMPRESSED_RGB_S3TC_DXT1_EXT or GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+    uint32_t width;
+    uint32_t height;
+    uint32_t layers;
+    uint32_t levels;
+    uint32_t reserved;
+};
+
+// bytes in one layer of a BC1 (8 bytes per 4x4 block) or BC3 (16 bytes) level
+inline uint32_t compressedLayerSize(uint32_t format, uint32_t width, uint32_t height)
+{
+    uint32_t blocks = ((width + 3) / 4) * ((height + 3) / 4);
+    return blocks * (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16);
+}
+
+// returns the header and points levelSizes/data into file, or false if the
+// file is not a texture array
+inline bool parseTextureArray(const AssetView& file, TextureArrayHeader& header, const uint32_t*& levelSizes, const unsigned char*& data)
+{
+    if (!file.valid() || file.size < sizeof(TextureArrayHeader))
+        return false;
+    header = *(const TextureArrayHeader*)file.data;
+    if (header.magic != TEXTURE_ARRAY_MAGIC || header.version != TEXTURE_ARRAY_VERSION || header.levels == 0
+        || sizeof(TextureArrayHeader) + header.levels * sizeof(uint32_t) > file.size)
+        return false;
+    levelSizes = (const uint32_t*)(file.data + sizeof(TextureArrayHeader));
+    data = (const unsigned char*)(levelSizes + header.levels);
+    size_t total = 0;
+    for (uint32_t level = 0; level < header.levels; level++)
+        total += levelSizes[level];
+    return (size_t)(data - file.data) + total <= file.size;
+}
+
+#endif
@@ -0,0 +1,297 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+// the implementation is compiled into main.cpp; only pull in the declarations
+#ifndef STBI_INCLUDE_STB_IMAGE_H
+#include "stb_image/stb_image.h"
+#endif
+#include "asset/AssetPack.h"
+#include "texture/TextureArray.h"
+#include "profile/Profiler.h"
+#include "memory/MemoryTracker.h"
+
+// texture that is filled in asynchronously; ID is a valid texture name from
+// the start, but only has an image once ready is set
+struct TextureHandle {
+    unsigned int ID = 0;
+    GLenum Target = GL_TEXTURE_2D;
+    bool ready = false;
+};
+
+// Asynchronous texture loading.
+//
+// Load*() returns immediately. Update(), called once per frame on the GL
+// thread, maps a pixel buffer object for each queued texture and hands it to
+// a worker thread. The worker copies the baked texture array levels into the
+// mapping, or decodes an image with stbi_load_from_memory into a heap buffer
+// and copies that across. Staged textures are then uploaded from their
+// buffers, at most BytesPerFrame per frame, and their handles become ready.
+class TextureLoader {
+public:
+    // Loader options
+    size_t BytesPerFrame;
+    size_t MaxStagingBytes;
+    // Loader statistics
+    uint64_t UploadedBytes = 0;
+
+    TextureLoader(const AssetPack& assets, size_t bytesPerFrame = 4 << 20, size_t maxStagingBytes = 64 << 20) : BytesPerFrame(bytesPerFrame), MaxStagingBytes(maxStagingBytes), assets(assets) {
+        unsigned int count = std::thread::hardware_concurrency();
+        count = count > 1 ? count - 1 : 1;
+        for (unsigned int i = 0; i < count; i++)
+            workers.emplace_back(&TextureLoader::work, this);
+    }
+
+    ~TextureLoader() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    // 2D RGBA texture from a PNG (or any stb_image format), with mipmaps
+    const TextureHandle& LoadTexture(const std::string& name) {
+        return queue(name, false);
+    }
+
+    // GL_TEXTURE_2D_ARRAY from a tools/bake_textures container
+    const TextureHandle& LoadTextureArray(const std::string& name) {
+        return queue(name, true);
+    }
+
+    // true once every requested texture is ready
+    bool Idle() const {
+        return waiting.empty() && staging.empty();
+    }
+
+    void Update() {
+        PROFILE_SCOPE("texture upload");
+        stageWaiting();
+        uploadStaged();
+    }
+
+private:
+    struct Upload {
+        GLint level;
+        GLsizei width, height, layers;
+        size_t offset, size;
+    };
+
+    struct Job {
+        TextureHandle* handle;
+        std::string name;
+        bool isArray;
+        AssetView file;
+        GLenum format = GL_RGBA;
+        std::vector<Upload> uploads;
+        size_t size = 0;
+        unsigned int pbo = 0;
+        unsigned char* mapped = nullptr;
+        std::vector<unsigned char> fallback;   // used when the buffer cannot be mapped
+        std::atomic<bool> staged { false };
+        bool failed = false;
+    };
+
+    const AssetPack& assets;
+    std::deque<TextureHandle> handles;
+    std::list<std::unique_ptr<Job>> waiting;   // requested, no buffer yet (GL thread only)
+    std::list<std::unique_ptr<Job>> staging;   // handed to workers (GL thread only)
+    std::deque<Job*> pending;                  // shared with workers
+    size_t stagingBytes = 0;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::chrono::steady_clock::time_point started;
+
+    const TextureHandle& queue(const std::string& name, bool isArray) {
+        if (Idle())
+            started = std::chrono::steady_clock::now();
+        handles.emplace_back();
+        TextureHandle& handle = handles.back();
+        glGenTextures(1, &handle.ID);
+        handle.Target = isArray ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+
+        std::unique_ptr<Job> job(new Job());
+        job->handle = &handle;
+        job->name = name;
+        job->isArray = isArray;
+        job->file = assets.Get(name);
+        if (!plan(*job))
+            std::cout << "Texture failed to load at path: " << name << std::endl;
+        else
+            waiting.push_back(std::move(job));
+        return handle;
+    }
+
+    // work out the upload layout from the file header alone
+    bool plan(Job& job) {
+        if (!job.file.valid())
+            return false;
+        if (job.isArray) {
+            TextureArrayHeader header;
+            const uint32_t* levelSizes;
+            const unsigned char* data;
+            if (!parseTextureArray(job.file, header, levelSizes, data))
+                return false;
+            job.format = header.format;
+            GLsizei width = header.width, height = header.height;
+            for (uint32_t level = 0; level < header.levels; level++) {
+                job.uploads.push_back({ (GLint)level, width, height, (GLsizei)header.layers, job.size, levelSizes[level] });
+                job.size += levelSizes[level];
+                width = width > 1 ? width / 2 : 1;
+                height = height > 1 ? height / 2 : 1;
+            }
+        }
+        else {
+            int width, height, components;
+            if (!stbi_info_from_memory(job.file.data, (int)job.file.size, &width, &height, &components))
+                return false;
+            job.size = (size_t)width * height * 4;
+            job.uploads.push_back({ 0, width, height, 1, 0, job.size });
+        }
+        return true;
+    }
+
+    // give queued textures a mapped buffer and pass them to the workers
+    void stageWaiting() {
+        while (!waiting.empty() && (stagingBytes == 0 || stagingBytes + waiting.front()->size <= MaxStagingBytes)) {
+            std::unique_ptr<Job> job = std::move(waiting.front());
+            waiting.pop_front();
+            glGenBuffers(1, &job->pbo);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, job->pbo);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, job->size, NULL, GL_STREAM_DRAW);
+            job->mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, job->size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            if (job->mapped == nullptr) {
+                glDeleteBuffers(1, &job->pbo);
+                job->pbo = 0;
+                job->fallback.resize(job->size);
+                job->mapped = job->fallback.data();
+            }
+            stagingBytes += job->size;
+            MemoryTracker::Get().Allocate(MEMORY_IO, job->size);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending.push_back(job.get());
+            }
+            wake.notify_one();
+            staging.push_back(std::move(job));
+        }
+    }
+
+    // upload finished textures in request order, within the frame budget
+    void uploadStaged() {
+        size_t uploaded = 0;
+        while (!staging.empty() && staging.front()->staged.load(std::memory_order_acquire)) {
+            Job& job = *staging.front();
+            if (uploaded > 0 && uploaded + job.size > BytesPerFrame)
+                break;
+            upload(job);
+            uploaded += job.size;
+            UploadedBytes += job.size;
+            stagingBytes -= job.size;
+            MemoryTracker::Get().Free(MEMORY_IO, job.size);
+            staging.pop_front();
+            if (Idle()) {
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+                std::cout << "textures loaded in " << ms << " ms on " << workers.size() << " worker(s)" << std::endl;
+            }
+        }
+    }
+
+    void upload(Job& job) {
+        const unsigned char* source = nullptr;   // offsets into the bound buffer
+        if (job.pbo != 0) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, job.pbo);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        else {
+            source = job.fallback.data();
+        }
+        TextureHandle& handle = *job.handle;
+        glBindTexture(handle.Target, handle.ID);
+        if (!job.failed) {
+            for (const Upload& u : job.uploads) {
+                if (job.isArray)
+                    glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, u.level, job.format, u.width, u.height, u.layers, 0, (GLsizei)u.size, source + u.offset);
+                else
+                    glTexImage2D(GL_TEXTURE_2D, u.level, GL_RGBA, u.width, u.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, source + u.offset);
+            }
+        }
+        if (job.isArray) {
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint)job.uploads.size() - 1);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        }
+        else {
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        }
+        if (job.pbo != 0) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glDeleteBuffers(1, &job.pbo);
+        }
+        if (job.failed)
+            std::cout << "Texture failed to load at path: " << job.name << std::endl;
+        else
+            // generated mipmaps add a third to a plain texture
+            MemoryTracker::Get().Allocate(MEMORY_TEXTURES, job.isArray ? job.size : job.size * 4 / 3);
+        handle.ready = !job.failed;
+    }
+
+    // worker thread: decode or copy into the staging buffer
+    void work() {
+        Profiler::Get().SetThreadName("texture worker");
+        while (true) {
+            Job* job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !pending.empty(); });
+                if (stopping)
+                    return;
+                job = pending.front();
+                pending.pop_front();
+            }
+            PROFILE_SCOPE("decode texture");
+            if (job->isArray) {
+                const unsigned char* levels = job->file.data + sizeof(TextureArrayHeader) + job->uploads.size() * sizeof(uint32_t);
+                memcpy(job->mapped, levels, job->size);
+            }
+            else {
+                int width, height, components;
+                unsigned char* data = stbi_load_from_memory(job->file.data, (int)job->file.size, &width, &height, &components, 4);
+                if (data != NULL && (size_t)width * height * 4 == job->size)
+                    memcpy(job->mapped, data, job->size);
+                else
+                    job->failed = true;
+                stbi_image_free(data);
+            }
+            job->staged.store(true, std::memory_order_release);
+        }
+    }
+};
+
+#endif
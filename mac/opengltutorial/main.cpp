@@ -7,7 +7,15 @@
 //
 
 #include <iostream>
+#include <fstream>
 #include <cmath>
+#include <chrono>
+#include <memory>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <thread>
+#include <atomic>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
@@ -18,16 +26,63 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image/stb_image.h"
 #include "shader/shader_s.h"
+#include "shader/ShaderCache.h"
+#include "shader/ShaderVariants.h"
 
 #include "camera/Camera.h"
 
 #include "block/Block.h"
 
+#include "save/WorldSave.h"
+
+#include "asset/AssetPack.h"
+
+#include "texture/TextureLoader.h"
+
+#include "platform/GlfwBackend.h"
+#include "platform/HeadlessBackend.h"
+
+#include "render/GlDevice.h"
+#include "render/NullDevice.h"
+#include "render/CaptureDevice.h"
+#include "render/RenderStats.h"
+#include "render/StatsOverlay.h"
+#include "render/RenderState.h"
+#include "render/ViewDistance.h"
+#include "render/TerrainLod.h"
+#include "render/HorizonClipmap.h"
+
+#include "profile/Profiler.h"
+#include "profile/FrameTiming.h"
+#include "profile/InputLatency.h"
+
+#include "memory/MemoryTracker.h"
+#include "memory/FrameAllocator.h"
+#define ALLOCATION_TRACKER_IMPLEMENTATION
+#include "memory/AllocationTracker.h"
+
+#include "bench/Flythrough.h"
+
+#include "simulation/FixedTimestep.h"
+
+#include "input/InputQueue.h"
+
+#include "log/Logger.h"
+
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
+// assets (assets.pack and the save directory live next to the binary)
+AssetPack assets;
+
+ShaderCache shaderCache(executableDirectory() + "/shadercache");
+
 // world
 std::vector<Block> blocks;
+WorldSave worldSave(executableDirectory() + "/save");
+
+// handed from the simulation (main) thread to the render thread every frame
+RenderStateBuffer renderStates;
 
 // camera
 Camera camera(&blocks, glm::vec3(0.0f, 0.0f, 3.0f));
@@ -42,7 +97,18 @@ float lastX = SCR_WIDTH / 2.0;
 float lastY = SCR_HEIGHT / 2.0;
 float fov = 45.0f;
 
-// timing
+// input: pushed by the GLFW callbacks, applied by the simulation each tick
+InputQueue inputEvents;
+InputRecording inputRecording;
+InputRecording inputReplay;
+bool recordingInput = false;
+bool replayingInput = false;
+bool keysDown[GLFW_KEY_LAST + 1];
+// the cursor as of its last event, for the renderer to late-latch
+CursorLatch cursorLatch;
+double lastCursorTime = 0.0;
+
+// timing; deltaTime is the simulation tick while ticking
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 float currentFrame;
@@ -52,94 +118,163 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     glViewport(0, 0, width, height);
 }
 
-// glfw: whenever the mouse moves, this callback is called
-// -------------------------------------------------------
+// glfw: the input callbacks only queue the event for the simulation
+// -----------------------------------------------------------------
 void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 {
-    if (firstMouse)
+    double time = glfwGetTime();
+    inputEvents.Push({ INPUT_CURSOR, 0, 0, xpos, ypos, time });
+    cursorLatch.Store(xpos, ypos, time);
+}
+
+void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
+{
+    inputEvents.Push({ INPUT_MOUSE_BUTTON, button, action, 0.0, 0.0, glfwGetTime() });
+}
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    inputEvents.Push({ INPUT_KEY, key, action, 0.0, 0.0, glfwGetTime() });
+}
+
+void handleInputEvent(const InputEvent& event)
+{
+    if (event.Type == INPUT_KEY)
     {
-        lastX = xpos;
-        lastY = ypos;
-        firstMouse = false;
+        if (event.Code >= 0 && event.Code <= GLFW_KEY_LAST)
+            keysDown[event.Code] = event.Action != GLFW_RELEASE;
     }
+    else if (event.Type == INPUT_CURSOR)
+    {
+        if (firstMouse)
+        {
+            lastX = event.X;
+            lastY = event.Y;
+            firstMouse = false;
+        }
 
-    float xoffset = xpos - lastX;
-    float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
-    
-    lastX = xpos;
-    lastY = ypos;
+        float xoffset = event.X - lastX;
+        float yoffset = lastY - event.Y; // reversed since y-coordinates go from bottom to top
+        
+        lastX = event.X;
+        lastY = event.Y;
+        lastCursorTime = event.Time;
 
-    camera.ProcessMouseMovement(xoffset, yoffset);
+        camera.ProcessMouseMovement(xoffset, yoffset);
+    }
+    else if (event.Type == INPUT_MOUSE_BUTTON && event.Action == GLFW_PRESS)
+    {
+        if (event.Code == GLFW_MOUSE_BUTTON_LEFT)
+            camera.DestroyBlock();
+        else if (event.Code == GLFW_MOUSE_BUTTON_RIGHT)
+            camera.PlaceBlock();
+    }
 }
 
-void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
-    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
-        camera.DestroyBlock();
+// simulation: apply the input queued since the last tick, recording it or
+// replacing it with a recording's
+void consumeInput(uint64_t tick)
+{
+    PROFILE_SCOPE("consumeInput");
+    if (replayingInput)
+    {
+        InputEvent ignored;
+        while (inputEvents.Pop(ignored)) {}
+        inputReplay.Replay(tick, inputEvents);
     }
-    else if (button = GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS) {
-        camera.PlaceBlock();
+    InputEvent event;
+    while (inputEvents.Pop(event))
+    {
+        if (recordingInput)
+            inputRecording.Record(tick, event);
+        handleInputEvent(event);
     }
+}
+
+// camera: whenever a block is placed or destroyed, this callback is called
+// -------------------------------------------------------------------------
+void block_edit_callback(const Block& block, bool placed)
+{
+    // the render thread's copy of the world follows the edits in the render state
+    renderStates.Back().Edits.push_back({ block, placed });
+    if (!worldSave.Running())
+        return;
+    if (placed)
+        worldSave.RecordPlace(block);
+    else
+        worldSave.RecordDestroy(block);
+}
 
-    /*if (button = GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE) {
-        camera.UnlockDestroy();
+// render thread: bring its copy of the world up to date
+void applyBlockEdit(std::vector<Block>& world, const BlockEdit& edit)
+{
+    if (edit.placed)
+    {
+        world.push_back(edit.block);
+        return;
+    }
+    for (size_t i = 0; i < world.size(); i++)
+    {
+        if (world[i].position == edit.block.position)
+        {
+            world.erase(world.begin() + i);
+            return;
+        }
     }
-    if (button = GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_RELEASE) {
-        camera.UnlockPlace();
-    }*/
+}
+
+// true on the tick a key goes down
+bool keyPressed(int key, bool& down)
+{
+    bool pressed = keysDown[key];
+    bool first = pressed && !down;
+    down = pressed;
+    return first;
 }
 
 void processInput(GLFWwindow* window)
 {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    PROFILE_SCOPE("processInput");
+    if (keysDown[GLFW_KEY_ESCAPE] && window != NULL)
         glfwSetWindowShouldClose(window, true);
-    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+    if (keysDown[GLFW_KEY_SPACE])
         camera.Jump();
-    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_RELEASE)
+    else
         camera.UnlockJump();
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    if (keysDown[GLFW_KEY_LEFT_SHIFT])
         camera.Sprint();
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_RELEASE)
+    else
         camera.Desprint();
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    if (keysDown[GLFW_KEY_W])
         camera.ProcessKeyboard(FORWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    if (keysDown[GLFW_KEY_S])
         camera.ProcessKeyboard(BACKWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    if (keysDown[GLFW_KEY_A])
         camera.ProcessKeyboard(LEFT, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    if (keysDown[GLFW_KEY_D])
         camera.ProcessKeyboard(RIGHT, deltaTime);
+    
+    // F3 shows the stats overlay, F12 writes a profile trace
+    static bool overlayKeyDown = false, traceKeyDown = false;
+    if (keyPressed(GLFW_KEY_F3, overlayKeyDown))
+        renderStates.Back().ToggleOverlay = true;
+    if (keyPressed(GLFW_KEY_F12, traceKeyDown))
+        renderStates.Back().WriteTrace = true;
 }
 
 void handleGravity() {
-    glm::vec3 pos = camera.Position;
-    float x = floor(pos.x);
-    float z = floor(pos.z);
-    float highest = -INFINITY;
-    for (Block b : blocks) {
-        if (b.position.x == x && b.position.z == z) {
-            highest = std::fmax(highest, b.position.y);
-        }
-    }
-    camera.Position.y = std::fmax(highest + 2.9f, camera.Position.y + camera.YVelocity * deltaTime);
-    if (camera.Position.y < camera.killPlane) {
-        camera.Position = glm::vec3(0, 2.9, 0);
-    }
-    if (camera.Position.y == highest + 2.9f) {
-        camera.YVelocity = 0;
-        camera.Gravity = -9.81f;
-        camera.grounded = true;
-    }
-    else {
-        camera.YVelocity += deltaTime * camera.Gravity;
-        camera.YVelocity = fmax(camera.TerminalVelocity, camera.YVelocity);
-    }
+    PROFILE_SCOPE("handleGravity");
+    camera.ProcessGravity(deltaTime);
 }
 
 GLFWcursor* customCursor() {
     
     int width, height, nrChannels;
     
-    unsigned char *cursor_img = stbi_load("/Users/georgewu/openglgame/mac/opengltutorial/resources/crosshair.png", &width, &height, &nrChannels, 0);
+    AssetView cursor = assets.Get("crosshair.png");
+    if (!cursor.valid())
+        return NULL;
+    unsigned char *cursor_img = stbi_load_from_memory(cursor.data, (int)cursor.size, &width, &height, &nrChannels, 0);
     
     
     GLFWimage image;
@@ -150,83 +285,218 @@ GLFWcursor* customCursor() {
     return glfwCreateCursor(&image, width/2, height/2);
 }
 
-// utility function for loading a 2D texture from file
-// ---------------------------------------------------
-unsigned int loadTexture(char const * path)
+// generating the initial plain of grass, size blocks across
+void generateWorld(int size = 40)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
+    float half = size / 2;
+    for (float j = -half; j < size - half; j += 1)
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-        stbi_image_free(data);
+        for (float i = -half; i < size - half; i += 1)
+        {
+            blocks.emplace_back(glm::vec3(i, -1, j), grass, true);
+        }
     }
-    else
+    for (float j = -5.0; j < 5.0; j += 1)
     {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        for (float i = -5.0; i < 5.0; i += 1)
+        {
+            blocks.emplace_back(glm::vec3(i, 0, j), grass, true);
+        }
     }
-
-    return textureID;
 }
 
+// command line options
+struct RunOptions
+{
+    bool headless = false;          // render offscreen instead of opening a window
+    int frames = 600;               // frames to render when headless
+    int captureEvery = 0;           // write every Nth headless frame to a PNG
+    std::string captureDirectory = ".";
+    std::string timingsPath;        // CSV of per-frame times
+    bool nullDevice = false;        // count draw calls and uniforms instead of issuing them
+    int worldSize = 40;             // width of the generated plain
+    std::string capturePath;        // record frames for tools/replay_capture
+    int captureAt = 0;              // first frame to capture, once textures are in
+    int captureFrames = 1;
+    bool profile = false;           // record profile scopes; F12 writes a trace
+    std::string tracePath = "trace.json";
+    bool traceOnExit = false;
+    std::string statsPath;          // CSV of per-frame render stats
+    bool overlay = false;           // start with the stats overlay shown (F3)
+    double budgetMs = 50.0;         // frames slower than this are logged (20 fps target)
+    std::string benchmarkPath;      // flythrough script; implies --headless
+    std::string reportPath = "benchmark.json";
+    double memoryReport = 0.0;      // seconds between memory reports
+    std::vector<std::pair<MemoryTag, double>> memoryBudgets;   // MB per tag
+    bool checkAllocations = false;  // fail if steady-state frames heap-allocate
+    double tickRate = 60.0;         // simulation ticks per second
+    int maxTicks = 5;               // most ticks a frame runs to catch up
+    std::string recordInputPath;    // write the run's input events here
+    std::string replayInputPath;    // play these input events instead
+    bool lateLatch = true;          // re-aim each frame with the newest mouse movement
+    float viewDistance = 0.0f;      // fixed view distance; 0 adapts it, except headless
+    double targetMs = 1000.0 / 60.0;    // frame time the adaptive view distance holds
+    float fogStart = 0.6f;          // fraction of the view distance where fog begins
+    float lodDistance = 32.0f;      // far regions this far away use downsampled meshes; 0 never
+    int horizonLevels = 7;          // clipmap levels of heightmap terrain past the view distance; 0 none
+};
 
-int main()
+bool parseOptions(int argc, char** argv, RunOptions& options)
 {
-    // initialize glfw
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-    
-  
-    
-    // use glfw to create window
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Make Game World", NULL, NULL);
-    if (window == NULL)
+    for (int i = 1; i < argc; i++)
     {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--headless") == 0)
+            options.headless = true;
+        else if (strcmp(argv[i], "--frames") == 0 && hasValue)
+            options.frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--capture-every") == 0 && hasValue)
+            options.captureEvery = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--capture-dir") == 0 && hasValue)
+            options.captureDirectory = argv[++i];
+        else if (strcmp(argv[i], "--timings") == 0 && hasValue)
+            options.timingsPath = argv[++i];
+        else if (strcmp(argv[i], "--null-device") == 0)
+            options.nullDevice = true;
+        else if (strcmp(argv[i], "--world-size") == 0 && hasValue)
+            options.worldSize = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--capture") == 0 && hasValue)
+            options.capturePath = argv[++i];
+        else if (strcmp(argv[i], "--capture-at") == 0 && hasValue)
+            options.captureAt = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--capture-frames") == 0 && hasValue)
+            options.captureFrames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--profile") == 0)
+            options.profile = true;
+        else if (strcmp(argv[i], "--trace") == 0 && hasValue)
+        {
+            options.profile = options.traceOnExit = true;
+            options.tracePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--stats") == 0 && hasValue)
+            options.statsPath = argv[++i];
+        else if (strcmp(argv[i], "--overlay") == 0)
+            options.overlay = true;
+        else if (strcmp(argv[i], "--budget-ms") == 0 && hasValue)
+            options.budgetMs = atof(argv[++i]);
+        else if (strcmp(argv[i], "--benchmark") == 0 && hasValue)
+        {
+            options.headless = true;
+            options.benchmarkPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--report") == 0 && hasValue)
+            options.reportPath = argv[++i];
+        else if (strcmp(argv[i], "--check-allocations") == 0)
+            options.checkAllocations = true;
+        else if (strcmp(argv[i], "--tick-rate") == 0 && hasValue)
+            options.tickRate = atof(argv[++i]);
+        else if (strcmp(argv[i], "--max-ticks") == 0 && hasValue)
+            options.maxTicks = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--record-input") == 0 && hasValue)
+            options.recordInputPath = argv[++i];
+        else if (strcmp(argv[i], "--replay-input") == 0 && hasValue)
+            options.replayInputPath = argv[++i];
+        else if (strcmp(argv[i], "--no-late-latch") == 0)
+            options.lateLatch = false;
+        else if (strcmp(argv[i], "--view-distance") == 0 && hasValue)
+        {
+            // "auto" adapts it even when headless
+            options.viewDistance = strcmp(argv[++i], "auto") == 0 ? -1.0f : (float)atof(argv[i]);
+        }
+        else if (strcmp(argv[i], "--target-ms") == 0 && hasValue)
+            options.targetMs = atof(argv[++i]);
+        else if (strcmp(argv[i], "--fog-start") == 0 && hasValue)
+            options.fogStart = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--lod-distance") == 0 && hasValue)
+            options.lodDistance = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--horizon-levels") == 0 && hasValue)
+            options.horizonLevels = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--memory-report") == 0 && hasValue)
+            options.memoryReport = atof(argv[++i]);
+        else if (strcmp(argv[i], "--memory-budget") == 0 && hasValue && strchr(argv[i + 1], '=') != NULL)
+        {
+            std::string budget = argv[++i];
+            size_t split = budget.find('=');
+            MemoryTag tag = MemoryTracker::TagFromName(budget.substr(0, split));
+            if (tag == MEMORY_TAGS)
+            {
+                std::cout << "unknown memory tag " << budget.substr(0, split) << std::endl;
+                return false;
+            }
+            options.memoryBudgets.push_back(std::make_pair(tag, atof(budget.c_str() + split + 1)));
+        }
+        else
+        {
+            std::cout << "usage: " << argv[0] << " [--headless] [--frames N] [--capture-every N] [--capture-dir DIR] [--timings FILE] [--null-device] [--world-size N]"
+                      << " [--capture FILE] [--capture-at N] [--capture-frames N] [--profile] [--trace FILE]"
+                      << " [--stats FILE] [--overlay] [--budget-ms MS] [--benchmark SCRIPT] [--report FILE]"
+                      << " [--memory-report SECONDS] [--memory-budget TAG=MB] [--check-allocations]"
+                      << " [--tick-rate HZ] [--max-ticks N] [--record-input FILE] [--replay-input FILE] [--no-late-latch]"
+                      << " [--view-distance N|auto] [--target-ms MS] [--fog-start FRACTION] [--lod-distance N] [--horizon-levels N]" << std::endl;
+            return false;
+        }
     }
-    glfwMakeContextCurrent(window);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetMouseButtonCallback(window, mouse_button_callback);
-    // tell GLFW to capture our mouse
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
-    
-//    // make crosshair cursor
-//    GLFWcursor* cursor = customCursor();
-//    glfwSetCursor(window, cursor);
+    return true;
+}
 
+int main(int argc, char** argv)
+{
+    auto startupBegin = std::chrono::steady_clock::now();
+    
+    RunOptions options;
+    if (!parseOptions(argc, argv, options))
+        return -1;
+    Profiler::Get().SetThreadName("main");
+    Profiler::Get().Enabled = options.profile;
+    MemoryTracker::Get().ReportInterval = options.memoryReport;
+    for (const auto& budget : options.memoryBudgets)
+        MemoryTracker::Get().SetBudget(budget.first, (int64_t)(budget.second * 1048576.0));
     
-    // use glad to load opengl pointers
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    // a benchmark runs until its script is done rather than for --frames
+    FlythroughScript benchmarkScript;
+    if (!options.benchmarkPath.empty() && !benchmarkScript.Load(options.benchmarkPath))
+        return -1;
+    recordingInput = !options.recordInputPath.empty();
+    replayingInput = !options.replayInputPath.empty();
+    if (replayingInput && !inputReplay.Load(options.replayInputPath))
+        return -1;
+    
+    // pick where frames go: a GLFW window, or an offscreen framebuffer
+    std::unique_ptr<Backend> backend;
+    if (options.headless)
+    {
+#ifdef HEADLESS_BACKEND_AVAILABLE
+        int frames = options.benchmarkPath.empty() ? options.frames : INT_MAX;
+        backend.reset(new HeadlessBackend(frames, options.captureEvery, options.captureDirectory));
+#else
+        std::cout << "Headless rendering is not available on this platform" << std::endl;
+        return -1;
+#endif
+    }
+    else
+    {
+        backend.reset(new GlfwBackend());
+    }
+    if (!backend->Init(SCR_WIDTH, SCR_HEIGHT, "Make Game World"))
     {
-        std::cout << "Failed to initialize GLAD" << std::endl;
+        backend->Shutdown();
         return -1;
     }
     
+    GLFWwindow* window = backend->Window();
+    if (window != NULL)
+    {
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetMouseButtonCallback(window, mouse_button_callback);
+        glfwSetKeyCallback(window, key_callback);
+        // tell GLFW to capture our mouse
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
+        
+//        // make crosshair cursor
+//        GLFWcursor* cursor = customCursor();
+//        glfwSetCursor(window, cursor);
+    }
+    
     // enable depth testing
     glEnable(GL_DEPTH_TEST);
     // enable usage of alpha value for transparency
@@ -235,43 +505,92 @@ int main()
     // gamma correction
     glEnable(GL_FRAMEBUFFER_SRGB);
     
-    // build and compile shaders shader
-    Shader ourShader("/Users/georgewu/openglgame/mac/opengltutorial/resources/shaders/3d_lighting.vs", "/Users/georgewu/openglgame/mac/opengltutorial/resources/shaders/3d_lighting.fs");
+    // map the asset pack built by tools/pack_assets; the Xcode build's Bake
+    // Assets phase bakes the textures and writes it next to the binary
+    if (!assets.Open(executableDirectory() + "/assets.pack"))
+    {
+        backend->Shutdown();
+        return -1;
+    }
+    
+    // build and compile shaders shader, reusing program binaries from earlier runs
+    if (options.profile)
+        Profiler::Get().InitGpu();
+    
+    shaderCache.Init(backend->Loader());
+    ShaderVariants::EnableParallelCompile(backend->Loader());
+    ShaderVariants blockShaders(assets, "shaders/3d_lighting.vs", "shaders/3d_lighting.fs", { "BLINN" }, &shaderCache);
+    unsigned int blockVariant = blockShaders.Key({ "BLINN" });
+    blockShaders.Build({ blockVariant });
+    Shader& ourShader = blockShaders.Get(blockVariant);
+    // far terrain shares the block fragment shader
+    ShaderVariants terrainShaders(assets, "shaders/terrain_lod.vs", "shaders/3d_lighting.fs", { "BLINN" }, &shaderCache);
+    terrainShaders.Build({ blockVariant });
+    Shader& terrainShader = terrainShaders.Get(blockVariant);
+    ShaderVariants horizonShaders(assets, "shaders/horizon.vs", "shaders/horizon.fs", { "BLINN" }, &shaderCache);
+    horizonShaders.Build({ blockVariant });
+    Shader& horizonShader = horizonShaders.Get(blockVariant);
+    
+    AssetView chVs = assets.Get("shaders/ch_shader.vs");
+    AssetView chFs = assets.Get("shaders/ch_shader.fs");
+    Shader chShader(chVs.text(), (GLint)chVs.size, chFs.text(), (GLint)chFs.size, nullptr, 0, &shaderCache);
     
-    Shader chShader("/Users/georgewu/openglgame/mac/opengltutorial/resources/shaders/ch_shader.vs", "/Users/georgewu/openglgame/mac/opengltutorial/resources/shaders/ch_shader.fs");
+    // per-frame draw calls and uniforms go through the device; the null one
+    // only counts them, leaving just the CPU cost of building the frame
+    NullDevice nullDevice;
+    Device* device = &GlDevice::Instance();
+    if (options.nullDevice)
+        device = &nullDevice;
+    CaptureDevice captureDevice(*device);
+    if (!options.capturePath.empty())
+    {
+        captureDevice.Init(backend->Loader());
+        device = &captureDevice;
+    }
+    bool captureStarted = false;
+    ourShader.device = device;
+    terrainShader.device = device;
+    horizonShader.device = device;
+    chShader.device = device;
+    
+    // per-frame draw, bind, uniform and upload counts, shown with F3
+    RenderStats stats;
+    stats.RecordAll = !options.statsPath.empty();
+    StatsOverlay statsOverlay(assets, &shaderCache);
+    statsOverlay.Visible = options.overlay;
     
     // create vertices of cube
     float cubeVertices[] = {
-        // positions         // texture coords // normals
-         0.0f, 0.0f, 1.0f, 0.5f, 0.5f,    -1.0f, 0.0f, 0.0f,
-         1.0f, 0.0f, 1.0f,  1.0f, 0.5f,    -1.0f, 0.0f, 0.0f,
-         0.0f, 1.0f, 1.0f,  0.5f, 0.0f,    -1.0f, 0.0f, 0.0f,
-         1.0f, 1.0f, 1.0f,   1.0f, 0.0f,    -1.0f, 0.0f, 0.0f,
-
-         1.0f, 0.0f, 1.0f,  0.5f, 0.5f,    0.0f, -1.0f, 0.0f,
-         1.0f, 0.0f, 0.0f, 1.0f, 0.5f,    0.0f, -1.0f, 0.0f,
-         1.0f, 1.0f, 1.0f,   0.5f, 0.0f,    0.0f, -1.0f, 0.0f,
-         1.0f, 1.0f, 0.0f,  1.0f, 0.0f,    0.0f, -1.0f, 0.0f,
-
-         1.0f, 0.0f, 0.0f, 0.5f, 0.5f,    1.0f, 0.0f, 0.0f,
-         0.0f, 0.0f, 0.0f,1.0f, 0.5f,    1.0f, 0.0f, 0.0f,
-         1.0f, 1.0f, 0.0f,  0.5f, 0.0f,    1.0f, 0.0f, 0.0f,
-         0.0f, 1.0f, 0.0f, 1.0f, 0.0f,    1.0f, 0.0f, 0.0f,
-
-         0.0f, 0.0f, 0.0f,0.5f, 0.5f,    0.0f, -1.0f, 0.0f,
-         0.0f, 0.0f, 0.5f, 1.0f, 0.5f,    0.0f, -1.0f, 0.0f,
-         0.0f, 1.0f, 0.0f, 0.5f, 0.0f,    0.0f, -1.0f, 0.0f,
-         0.0f, 1.0f, 1.0f,  1.0f, 0.0f,    0.0f, -1.0f, 0.0f,
-
-         0.0f, 0.0f, 0.0f,0.0f, 0.5f,    0.0f, 0.0f, -1.0f,
-         1.0f, 0.0f, 0.0f, 0.0f, 1.0f,    0.0f, 0.0f, -1.0f,
-         0.0f, 0.0f, 1.0f, 0.5f, 0.5f,    0.0f, 0.0f, -1.0f,
-         1.0f, 0.0f, 1.0f,  0.5f, 1.0f,    0.0f, 0.0f, -1.0f,
-
-         0.0f, 1.0f, 1.0f, 0.0f, 0.0f,     0.0f, 0.0f, 1.0f,
-         1.0f, 1.0f, 1.0f,  0.0f, 0.5f,     0.0f, 0.0f, 1.0f,
-         0.0f, 1.0f, 0.0f,0.5f, 0.0f,     0.0f, 0.0f, 1.0f,
-         1.0f, 1.0f, 0.0f, 0.5f, 0.5f,     0.0f, 0.0f, 1.0f
+        // positions         // texture coords // normals      // face (0 top, 1 side, 2 bottom)
+         0.0f, 0.0f, 1.0f,  0.0f, 1.0f,    0.0f,  0.0f,  1.0f,    1.0f,
+         1.0f, 0.0f, 1.0f,  1.0f, 1.0f,    0.0f,  0.0f,  1.0f,    1.0f,
+         0.0f, 1.0f, 1.0f,  0.0f, 0.0f,    0.0f,  0.0f,  1.0f,    1.0f,
+         1.0f, 1.0f, 1.0f,  1.0f, 0.0f,    0.0f,  0.0f,  1.0f,    1.0f,
+
+         1.0f, 0.0f, 1.0f,  0.0f, 1.0f,    1.0f,  0.0f,  0.0f,    1.0f,
+         1.0f, 0.0f, 0.0f,  1.0f, 1.0f,    1.0f,  0.0f,  0.0f,    1.0f,
+         1.0f, 1.0f, 1.0f,  0.0f, 0.0f,    1.0f,  0.0f,  0.0f,    1.0f,
+         1.0f, 1.0f, 0.0f,  1.0f, 0.0f,    1.0f,  0.0f,  0.0f,    1.0f,
+
+         1.0f, 0.0f, 0.0f,  0.0f, 1.0f,    0.0f,  0.0f, -1.0f,    1.0f,
+         0.0f, 0.0f, 0.0f,  1.0f, 1.0f,    0.0f,  0.0f, -1.0f,    1.0f,
+         1.0f, 1.0f, 0.0f,  0.0f, 0.0f,    0.0f,  0.0f, -1.0f,    1.0f,
+         0.0f, 1.0f, 0.0f,  1.0f, 0.0f,    0.0f,  0.0f, -1.0f,    1.0f,
+
+         0.0f, 0.0f, 0.0f,  0.0f, 1.0f,   -1.0f,  0.0f,  0.0f,    1.0f,
+         0.0f, 0.0f, 0.5f,  1.0f, 1.0f,   -1.0f,  0.0f,  0.0f,    1.0f,
+         0.0f, 1.0f, 0.0f,  0.0f, 0.0f,   -1.0f,  0.0f,  0.0f,    1.0f,
+         0.0f, 1.0f, 1.0f,  1.0f, 0.0f,   -1.0f,  0.0f,  0.0f,    1.0f,
+
+         0.0f, 0.0f, 0.0f,  0.0f, 0.0f,    0.0f, -1.0f,  0.0f,    2.0f,
+         1.0f, 0.0f, 0.0f,  0.0f, 1.0f,    0.0f, -1.0f,  0.0f,    2.0f,
+         0.0f, 0.0f, 1.0f,  1.0f, 0.0f,    0.0f, -1.0f,  0.0f,    2.0f,
+         1.0f, 0.0f, 1.0f,  1.0f, 1.0f,    0.0f, -1.0f,  0.0f,    2.0f,
+
+         0.0f, 1.0f, 1.0f,  0.0f, 0.0f,    0.0f,  1.0f,  0.0f,    0.0f,
+         1.0f, 1.0f, 1.0f,  0.0f, 1.0f,    0.0f,  1.0f,  0.0f,    0.0f,
+         0.0f, 1.0f, 0.0f,  1.0f, 0.0f,    0.0f,  1.0f,  0.0f,    0.0f,
+         1.0f, 1.0f, 0.0f,  1.0f, 1.0f,    0.0f,  1.0f,  0.0f,    0.0f
     };
     
     unsigned int cubeIndices[] = {
@@ -316,13 +635,16 @@ int main()
     
     // tell opengl how to interpret vertex data
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)0);
     // texture
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(3 * sizeof(float)));
     // normals
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(5 * sizeof(float)));
+    // face
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(8 * sizeof(float)));
                  
     
     glBindVertexArray(VAOs[1]);    // note that we bind to a different VAO now
@@ -332,91 +654,429 @@ int main()
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(chIndices), chIndices, GL_STATIC_DRAW);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0); // because the vertex data is tightly packed we can also specify 0 as the vertex attribute's stride to let OpenGL figure it out
     glEnableVertexAttribArray(0);
+    
+    size_t meshBytes = sizeof(cubeVertices) + sizeof(cubeIndices) + sizeof(chVertices) + sizeof(chIndices);
+    MemoryTracker::Get().Allocate(MEMORY_GEOMETRY, meshBytes);
+    MemoryTracker::Get().Allocate(MEMORY_GPU_BUFFERS, meshBytes);
 
-    unsigned int texture_all = loadTexture("/Users/georgewu/openglgame/mac/opengltutorial/resources/textures/grass_all.png");
+    // block textures, baked into a compressed texture array by tools/bake_textures;
+    // they stream in over the first frames while the window is already up
+    TextureLoader textureLoader(assets);
+    const TextureHandle& blockTextures = textureLoader.LoadTextureArray("textures/blocks.texarray");
     
     ourShader.use();
     
     // set uniforms
-    ourShader.setInt("texture_all", 3);
-    
-    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-    ourShader.setMat4("projection", projection);
+    ourShader.setInt("blockTextures", 0);
+    terrainShader.use();
+    terrainShader.setInt("blockTextures", 0);
+    horizonShader.use();
+    horizonShader.setInt("blockTextures", 0);
+    ourShader.use();
     
-    // generating the initial plain of grass
-    for (float j = -20.0; j < 20.0; j += 1)
+    // load the saved world, or generate the initial plain of grass; headless
+    // runs always use the generated (or benchmark) world and never touch the save
+    std::unique_ptr<FlythroughBenchmark> benchmark;
+    if (!options.benchmarkPath.empty())
     {
-        for (float i = -20.0; i < 20.0; i += 1)
+        if (!benchmarkScript.BuildWorld(blocks))
         {
-            blocks.emplace_back(glm::vec3(i, -1, j), grass, true);
+            backend->Shutdown();
+            return -1;
         }
+        benchmark.reset(new FlythroughBenchmark(benchmarkScript));
     }
-    for (float j = -5.0; j < 5.0; j += 1)
+    else if (options.headless)
     {
-        for (float i = -5.0; i < 5.0; i += 1)
-        {
-            blocks.emplace_back(glm::vec3(i, 0, j), grass, true);
-        }
+        generateWorld(options.worldSize);
+    }
+    else
+    {
+        if (!worldSave.Load(blocks))
+            generateWorld(options.worldSize);
+        worldSave.Start(blocks);
     }
+    camera.OnBlockEdit = block_edit_callback;
     
     
     glm::vec3 lightPos(0.0f, 7.0f, 0.0f);
+    // the clear color, which distant blocks fade into
+    glm::vec3 skyColor(0.2f, 0.3f, 0.3f);
+    
+    std::cout << "startup: " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupBegin).count() << " ms" << std::endl;
+    shaderCache.Report();
+    Logger::Get().Register();
+    
+    std::vector<double> frameTimes;
+    frameTimes.reserve(options.headless ? options.frames : 4096);
+    FrameTiming frameTiming(options.budgetMs);
+    MemoryGauge worldMemory(MEMORY_WORLD);
+    // transient per-frame data, all released at the end of the frame
+    FrameAllocator frameAllocator;
+    // frames after loading finishes that may still allocate while buffers
+    // reach their steady size; after that neither thread may allocate
+    const int ALLOCATION_WARMUP = 30;
+    FrameAllocationCheck simulationAllocations("simulation");
+    FrameAllocationCheck renderAllocations("render");
+    std::atomic<bool> steadyState { false };
+    std::atomic<bool> texturesReady { false };
+    // from the newest mouse input a frame shows to its present, with and
+    // without late latching
+    InputLatency latchedLatency, simulatedLatency;
+    // far plane and block draw distance, adjusted to hold the target frame
+    // time; headless runs keep it fixed so they stay comparable
+    ViewDistanceGovernor viewDistance(options.targetMs);
+    viewDistance.Adaptive = options.viewDistance < 0.0f || (options.viewDistance == 0.0f && !options.headless);
+    if (options.viewDistance > 0.0f)
+        viewDistance.MaxDistance = options.viewDistance;
+    
+    // The render thread owns the GL context from here on. It draws its own
+    // copy of the world, brought up to date by the edits in each render
+    // state, while the main thread simulates the next frame. Its frame time
+    // includes waiting for that state, reported as the simulation phase.
+    std::vector<Block> renderBlocks;
+    renderBlocks.reserve(blocks.capacity());
+    renderBlocks = blocks;
+    // distant regions drawn from downsampled meshes of that copy
+    TerrainLod terrainLod;
+    terrainLod.LodDistance = options.lodDistance;
+    // and the terrain beyond the view distance from its heightmap
+    HorizonClipmap horizon;
+    horizon.Levels = options.horizonLevels;
+    auto renderLoop = [&]()
+    {
+        Profiler::Get().SetThreadName("render");
+        // the view distance governor logs from this thread
+        Logger::Get().Register();
+        backend->MakeCurrent(true);
+        MemoryGauge renderWorldMemory(MEMORY_WORLD);
+        int steadyFrames = 0;
+        terrainLod.Build(renderBlocks);
+        horizon.Build(renderBlocks);
+        device->Counters.Reset();
+        
+        while (true)
+        {
+            // per-run records grow here, between frames
+            if (frameTimes.size() == frameTimes.capacity())
+                frameTimes.reserve(frameTimes.capacity() * 2);
+            stats.Reserve();
+            
+            PROFILE_SCOPE("frame");
+            double frameStart = backend->Time();
+            frameTiming.BeginFrame();
+            const RenderState* state = renderStates.Acquire();
+            if (state == nullptr)
+                break;
+            frameTiming.EndSimulation();
+            renderAllocations.Begin(steadyState.load());
+            stats.BeginFrame(device->Counters, textureLoader.UploadedBytes);
+            for (const BlockEdit& edit : state->Edits)
+            {
+                applyBlockEdit(renderBlocks, edit);
+                terrainLod.Changed(edit.block.position);
+                horizon.Changed(edit.block.position);
+            }
+            terrainLod.Update(*device, renderBlocks);
+            horizon.Update(*device, renderBlocks, state->ViewPos);
+            textureLoader.Update();
+            texturesReady.store(textureLoader.Idle());
+            
+            if (!options.capturePath.empty() && !captureStarted && (int)frameTimes.size() >= options.captureAt && textureLoader.Idle())
+            {
+                captureDevice.Begin(options.capturePath, options.captureFrames);
+                captureStarted = true;
+            }
+            
+            ourShader.use();
+            
+            // clear color and depth buffer
+            device->Clear(skyColor.r, skyColor.g, skyColor.b, 1.0f, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            
+            //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); // draws in wireframe mode
+            //glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); // to undo wireframe mode
+            
+            
+            // late latch: turn the view by the mouse movement that arrived
+            // since the simulation built it, right before drawing with it
+            glm::mat4 view = state->View;
+            double inputTime = state->InputTime;
+            double cursorX, cursorY, cursorTime;
+            if (options.lateLatch && state->CursorValid && cursorLatch.Load(cursorX, cursorY, cursorTime) && cursorTime > state->InputTime)
+            {
+                float yaw = state->Yaw + (float)(cursorX - state->CursorX) * state->MouseSensitivity;
+                float pitch = state->Pitch + (float)(state->CursorY - cursorY) * state->MouseSensitivity;
+                pitch = std::fmin(89.0f, std::fmax(-89.0f, pitch));
+                view = Camera::GetViewMatrix(state->ViewPos, yaw, pitch);
+                inputTime = cursorTime;
+            }
+            float distance = viewDistance.Distance();
+            glm::mat4 projection = glm::perspective(glm::radians(state->Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, distance);
+            ourShader.setMat4("projection", projection);
+            ourShader.setMat4("view", view);
+            // set light uniforms
+            ourShader.setVec3("viewPos", state->ViewPos);
+            ourShader.setVec3("lightPos", lightPos);
+            // fog reaches the sky color where nothing more is drawn, so the
+            // world fades out instead of ending in a hard line: at the view
+            // distance, where blocks stop, or with the horizon drawn past them
+            // at the nearer of its edge and the world's
+            float fogEnd = distance;
+            if (horizon.Enabled())
+                fogEnd = std::max(distance, std::min(horizon.EdgeDistance(state->ViewPos), horizon.Range()));
+            ourShader.setVec3("fogColor", skyColor);
+            ourShader.setVec2("fogRange", fogEnd * options.fogStart, fogEnd);
+            
+            if (horizon.Enabled())
+            {
+                PROFILE_SCOPE("draw horizon");
+                PROFILE_GPU_SCOPE("horizon");
+                // with its own depth range, out to its edge; the depth buffer
+                // is cleared after it, so blocks always draw over it
+                glm::mat4 horizonProjection = glm::perspective(glm::radians(state->Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, distance * 0.5f, horizon.Range() * 1.5f);
+                horizonShader.use();
+                horizonShader.setMat4("model", glm::mat4(1.0f));
+                horizonShader.setMat4("projection", horizonProjection);
+                horizonShader.setMat4("view", view);
+                horizonShader.setVec3("viewPos", state->ViewPos);
+                horizonShader.setVec3("lightPos", lightPos);
+                horizonShader.setVec3("fogColor", skyColor);
+                horizonShader.setVec2("fogRange", fogEnd * options.fogStart, fogEnd);
+                horizonShader.setFloat("horizonStart", distance);
+                device->BindTexture(GL_TEXTURE_2D_ARRAY, blockTextures.ID);
+                horizon.Draw(*device, horizonShader);
+                device->Clear(skyColor.r, skyColor.g, skyColor.b, 1.0f, GL_DEPTH_BUFFER_BIT);
+            }
+
+            int index = 0;
+            int farRegions = terrainLod.Select(state->ViewPos, distance);
+            
+            device->BindVertexArray(VAOs[0]);
+            device->BindTexture(GL_TEXTURE_2D_ARRAY, blockTextures.ID);
+            ourShader.use();
+            {
+                PROFILE_SCOPE("draw blocks");
+                PROFILE_GPU_SCOPE("blocks");
+                int boundType = -1;
+                // blocks whose nearest corner could still be inside the view distance
+                float drawDistance = distance + 0.87f;
+                float drawDistance2 = drawDistance * drawDistance;
+                for (const Block& b : renderBlocks)
+                {
+                    glm::vec3 offset = b.position + glm::vec3(0.5f) - state->ViewPos;
+                    if (glm::dot(offset, offset) > drawDistance2)
+                        continue;
+                    if (farRegions > 0 && terrainLod.Downsampled(b.position))
+                        continue;
+                    // texture layers only change between block types
+                    if (b.bt != boundType)
+                    {
+                        ourShader.setIVec3("faceLayers", BlockTextureLayers[b.bt][0], BlockTextureLayers[b.bt][1], BlockTextureLayers[b.bt][2]);
+                        boundType = b.bt;
+                    }
+                    glm::mat4 model = glm::mat4(1.0f);
+                    model = glm::translate(model, b.position);
+                    ourShader.setMat4("model", model);
+
+                    device->DrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, index * sizeof(GLuint));
+                }
+            }
+            
+            if (farRegions > 0)
+            {
+                PROFILE_SCOPE("draw far terrain");
+                PROFILE_GPU_SCOPE("far terrain");
+                terrainShader.use();
+                terrainShader.setMat4("model", glm::mat4(1.0f));
+                terrainShader.setMat4("projection", projection);
+                terrainShader.setMat4("view", view);
+                terrainShader.setVec3("viewPos", state->ViewPos);
+                terrainShader.setVec3("lightPos", lightPos);
+                terrainShader.setVec3("fogColor", skyColor);
+                terrainShader.setVec2("fogRange", fogEnd * options.fogStart, fogEnd);
+                terrainLod.Draw(*device);
+            }
+            
+            {
+                PROFILE_GPU_SCOPE("crosshair");
+                device->BindVertexArray(VAOs[1]);
+                chShader.use();
+                device->DrawElements(GL_TRIANGLES, 12, GL_UNSIGNED_INT, 0);
+            }
+            
+            stats.EndFrame(device->Counters, textureLoader.UploadedBytes);
+            if (state->ToggleOverlay)
+                statsOverlay.Visible = !statsOverlay.Visible;
+            statsOverlay.Draw(*device, stats, frameAllocator, SCR_WIDTH, SCR_HEIGHT);
+            frameTiming.EndRender();
+            
+            {
+                PROFILE_SCOPE("present");
+                backend->Present();
+            }
+            frameTiming.EndFrame();
+            double presentTime = backend->Time();
+            latchedLatency.Presented(inputTime, presentTime);
+            simulatedLatency.Presented(state->InputTime, presentTime);
+            renderWorldMemory.Set((int64_t)(renderBlocks.capacity() * sizeof(Block)));
+            captureDevice.EndFrame();
+            Profiler::Get().EndFrame();
+            if (state->WriteTrace)
+                Profiler::Get().WriteTrace(options.tracePath);
+            frameTimes.push_back((backend->Time() - frameStart) * 1000.0);
+            stats.SetFrameTime(frameTimes.back());
+            viewDistance.Frame(frameTimes.back());
+            frameAllocator.Reset();
+            renderAllocations.End(frameTimes.size() - 1);
+            
+            if (textureLoader.Idle() && steadyFrames < ALLOCATION_WARMUP)
+                steadyFrames++;
+            steadyState.store(options.checkAllocations && steadyFrames >= ALLOCATION_WARMUP);
+            if (benchmark && state->BenchmarkFrame >= 0)
+                benchmark->EndFrame(stats.Get(0), frameTimes.back());
+            if (backend->ShouldClose() || (benchmark && benchmark->Done()))
+                break;
+        }
+        renderStates.Close();
+        backend->MakeCurrent(false);
+    };
+    backend->MakeCurrent(false);
+    std::thread renderThread(renderLoop);
     
-    while(!glfwWindowShouldClose(window))
+    // physics runs on fixed ticks; the camera is drawn between the last two
+    FixedTimestep timestep(options.tickRate, options.maxTicks);
+    glm::vec3 previousPosition = camera.Position;
+    uint64_t simulatedFrames = 0;
+    uint64_t inputTick = 0;
+    while (!backend->ShouldClose() && !(benchmark && benchmark->Simulated()))
     {
-        currentFrame = glfwGetTime();
+        PROFILE_SCOPE("simulate");
+        simulationAllocations.Begin(steadyState.load());
+        currentFrame = backend->Time();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
-
-        handleGravity();
-        processInput(window);
-        
-        ourShader.use();
-        
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        // clear color and depth buffer
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        
-        //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); // draws in wireframe mode
-        //glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); // to undo wireframe mode
+        backend->PollEvents();
         
-        
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
-        // set light uniforms
-        ourShader.setVec3("viewPos", camera.Position);
-        ourShader.setVec3("lightPos", lightPos);
-
-        int index = 0;
-        
-        glBindVertexArray(VAOs[0]);
-        glBindTexture(GL_TEXTURE_2D, texture_all);   //use texture of ith face
-        ourShader.use();
-        for (Block b : blocks)
+        // edits made while simulating land in the state being built
+        RenderState& state = renderStates.Back();
+        glm::vec3 viewPosition = camera.Position;
+        // the script moves the camera, on a fixed step so every run is the same
+        if (benchmark)
         {
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, b.position);
-            ourShader.setMat4("model", model);
-
-            glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, (void*)(index * sizeof(GLuint)));
+            deltaTime = benchmarkScript.DeltaTime;
+            state.BenchmarkFrame = benchmark->BeginFrame(camera, texturesReady.load());
+            consumeInput(inputTick++);
+            processInput(window);
+        }
+        else
+        {
+            // headless runs take one tick a frame, so they simulate the same
+            // whatever the frame rate
+            int ticks = timestep.Advance(options.headless ? timestep.Tick() : deltaTime);
+            deltaTime = timestep.Tick();
+            for (int i = 0; i < ticks; i++)
+            {
+                previousPosition = camera.Position;
+                consumeInput(inputTick++);
+                handleGravity();
+                processInput(window);
+            }
+            viewPosition = glm::mix(previousPosition, camera.Position, timestep.Alpha());
         }
         
-        glBindVertexArray(VAOs[1]);
-        chShader.use();
-        glDrawElements(GL_TRIANGLES, 12, GL_UNSIGNED_INT, 0);
+        state.Zoom = camera.Zoom;
+        state.View = camera.GetViewMatrix(viewPosition);
+        state.ViewPos = viewPosition;
+        state.Yaw = camera.Yaw;
+        state.Pitch = camera.Pitch;
+        state.MouseSensitivity = camera.MouseSensitivity;
+        state.CursorValid = !firstMouse;
+        state.CursorX = lastX;
+        state.CursorY = lastY;
+        state.InputTime = replayingInput ? 0.0 : lastCursorTime;
+        worldMemory.Set((int64_t)(blocks.capacity() * sizeof(Block)));
+        MemoryTracker::Get().Update();
+        simulationAllocations.End(simulatedFrames++);
         
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        // wait for the renderer to take this frame, then build the next one
+        // while it draws
+        PROFILE_SCOPE("wait for render");
+        if (!renderStates.Publish())
+            break;
+    }
+    renderStates.Close();
+    renderThread.join();
+    backend->MakeCurrent(true);
+    
+    // write out the remaining edits
+    worldSave.Stop();
+    
+    if (options.traceOnExit)
+        Profiler::Get().WriteTrace(options.tracePath);
+    
+    // lines the threads logged come out before the reports, not among them
+    Logger::Get().Flush();
+    frameTiming.Report();
+    latchedLatency.Report(options.lateLatch ? "late latched" : "late latching off");
+    if (options.lateLatch)
+        simulatedLatency.Report("without late latching");
+    if (recordingInput)
+        inputRecording.Save(options.recordInputPath);
+    if (inputEvents.Dropped() > 0)
+        std::cout << inputEvents.Dropped() << " input events dropped" << std::endl;
+    if (timestep.DroppedTicks() > 0)
+        std::cout << timestep.Ticks() << " simulation ticks, " << timestep.DroppedTicks() << " dropped catching up" << std::endl;
+    if (benchmark)
+    {
+        benchmark->Report();
+        benchmark->WriteReport(options.reportPath);
+    }
+    if (stats.Frames() > 0)
+    {
+        FrameStats average = stats.Average();
+        std::cout << "last " << stats.Recent() << " frames: " << average.Milliseconds << " ms, " << average.DrawCalls << " draws, "
+                  << average.Triangles << " triangles, " << average.UniformCalls << " uniforms (" << average.UniformBytes << " bytes), "
+                  << average.ProgramBinds + average.TextureBinds + average.VertexArrayBinds << " binds"
+                  << (options.nullDevice ? " [null device]" : "") << std::endl;
+    }
+    if (!options.statsPath.empty())
+        stats.WriteCsv(options.statsPath);
+    if (options.memoryReport > 0.0)
+        MemoryTracker::Get().Report();
+    
+    if (!options.timingsPath.empty())
+    {
+        std::ofstream timings(options.timingsPath);
+        timings << "frame,ms\n";
+        for (size_t i = 0; i < frameTimes.size(); i++)
+            timings << i << "," << frameTimes[i] << "\n";
+        std::cout << "wrote " << frameTimes.size() << " frame timings to " << options.timingsPath << std::endl;
     }
     
     // delete resources after use
     glDeleteVertexArrays(1, VAOs);
     glDeleteBuffers(1, VBOs);
     glDeleteBuffers(1, EBOs);
+    MemoryTracker::Get().Free(MEMORY_GEOMETRY, meshBytes);
+    MemoryTracker::Get().Free(MEMORY_GPU_BUFFERS, meshBytes);
     
-    glfwTerminate();
+    backend->Shutdown();
+    Logger::Get().Flush();
+    if (Logger::Get().Dropped() > 0)
+        std::cout << Logger::Get().Dropped() << " log lines dropped" << std::endl;
+    uint64_t allocatingFrames = simulationAllocations.AllocatingFrames() + renderAllocations.AllocatingFrames();
+    if (options.checkAllocations)
+    {
+        if (!AllocationTracker::Enabled())
+            std::cout << "allocation tracking is compiled out" << std::endl;
+        else if (allocatingFrames > 0)
+        {
+            std::cout << allocatingFrames << " steady-state frame(s) allocated" << std::endl;
+            return 1;
+        }
+        else
+            std::cout << "no steady-state frame allocated" << std::endl;
+    }
     return 0;
 }
 
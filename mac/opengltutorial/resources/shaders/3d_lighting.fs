@@ -5,37 +5,20 @@ in VS_OUT {
     vec3 FragPos;
     vec3 Normal;
     vec2 TexCoords;
+    flat int Layer;
+    float EyeDistance;
 } fs_in;
 
-uniform sampler2D texture1;
+uniform sampler2DArray blockTextures;
 uniform vec3 lightPos;
 uniform vec3 viewPos;
-//uniform bool blinn;
+
+#include "include/lighting.glsl"
+#include "include/fog.glsl"
 
 void main()
 {
-    vec3 color = texture(texture1, fs_in.TexCoords).rgb;
-    // ambient
-    vec3 ambient = 0.03 * color;
-    // diffuse
-    vec3 lightDir = normalize(lightPos - fs_in.FragPos);
-    vec3 normal = normalize(fs_in.Normal);
-    float diff = max(dot(lightDir, normal), 0.0);
-    vec3 diffuse = diff * color;
-    // specular
-    vec3 viewDir = normalize(viewPos - fs_in.FragPos);
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = 0.0;
-//    if(blinn)
-//    {
-    vec3 halfwayDir = normalize(lightDir + viewDir);
-    spec = pow(max(dot(normal, halfwayDir), 0.0), 32.0);
-//    }
-//    else
-//    {
-//        vec3 reflectDir = reflect(-lightDir, normal);
-//        spec = pow(max(dot(viewDir, reflectDir), 0.0), 8.0);
-//    }
-    vec3 specular = vec3(0.3) * spec; // assuming bright white light color
-    FragColor = vec4(ambient + diffuse + specular, 1.0);
+    vec3 color = texture(blockTextures, vec3(fs_in.TexCoords, fs_in.Layer)).rgb;
+    vec3 lit = blockLighting(color, fs_in.Normal, fs_in.FragPos, lightPos, viewPos);
+    FragColor = vec4(applyFog(lit, fs_in.EyeDistance), 1.0);
 }
@@ -2,21 +2,27 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoords;
 layout (location = 2) in vec3 aNormal;
+layout (location = 3) in float aFace;
 
 out VS_OUT {
     vec3 FragPos;
     vec3 Normal;
     vec2 TexCoords;
+    flat int Layer;
+    float EyeDistance;
 } vs_out;
 
-uniform mat4 model;
-uniform mat4 projection;
-uniform mat4 view;
+// texture array layer for the top, side and bottom faces of this block
+uniform ivec3 faceLayers;
+
+#include "include/transform.glsl"
 
 void main()
 {
     vs_out.FragPos = aPos;
     vs_out.Normal = aNormal;
     vs_out.TexCoords = vec2(aTexCoords.x, aTexCoords.y);
-    gl_Position = projection * view * model * vec4(aPos, 1.0f);
+    vs_out.Layer = faceLayers[int(aFace)];
+    vs_out.EyeDistance = length(eyePosition(aPos));
+    gl_Position = transformPosition(aPos);
 }
@@ -0,0 +1,40 @@
+#version 330 core
+out vec4 FragColor;
+
+in VS_OUT {
+    vec3 WorldPos;
+    vec3 Normal;
+    flat int Layer;
+    flat int Level;
+} fs_in;
+
+uniform sampler2DArray blockTextures;
+uniform vec3 lightPos;
+uniform vec3 viewPos;
+uniform float horizonStart;             // nearer than this the blocks are drawn instead
+
+#include "include/clipmap.glsl"
+#include "include/lighting.glsl"
+#include "include/fog.glsl"
+
+void main()
+{
+    float eyeDistance = length(fs_in.WorldPos - viewPos);
+    if (fs_in.Layer < 0 || eyeDistance < horizonStart)
+        discard;
+    // the level inside this one covers its middle
+    if (fs_in.Level > 0)
+    {
+        float spacing = levelSpacing(fs_in.Level - 1);
+        vec2 inner = vec2(levelOrigin[fs_in.Level - 1]) * spacing;
+        vec2 p = fs_in.WorldPos.xz;
+        if (all(greaterThan(p, inner)) && all(lessThan(p, inner + float(CLIPMAP_CELLS) * spacing)))
+            discard;
+    }
+
+    // the smallest mip of the block's top texture is its average color
+    vec3 color = textureLod(blockTextures, vec3(0.5, 0.5, fs_in.Layer), 16.0).rgb;
+    // lit like the middle of a block top
+    vec3 lit = blockLighting(color, fs_in.Normal, vec3(0.5, 1.0, 0.5), lightPos, viewPos);
+    FragColor = vec4(applyFog(lit, eyeDistance), 1.0);
+}
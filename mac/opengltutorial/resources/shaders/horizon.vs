@@ -0,0 +1,44 @@
+#version 330 core
+layout (location = 0) in vec3 aGrid;    // vertex x, z in its level's window, and the level
+
+out VS_OUT {
+    vec3 WorldPos;
+    vec3 Normal;
+    flat int Layer;
+    flat int Level;
+} vs_out;
+
+#include "include/clipmap.glsl"
+#include "include/transform.glsl"
+
+void main()
+{
+    int level = int(aGrid.z);
+    ivec2 grid = ivec2(aGrid.xy);
+    ivec2 cell = levelOrigin[level] + grid;
+    vec2 value = clipmapCell(cell, level);
+    float height = value.r;
+
+    // the window's edge takes the surface of the level around it, halfway
+    // between its cells on odd vertices, so the two meet without cracks
+    bool edgeX = grid.x == 0 || grid.x == CLIPMAP_CELLS;
+    bool edgeZ = grid.y == 0 || grid.y == CLIPMAP_CELLS;
+    if (level + 1 < levels && (edgeX || edgeZ))
+    {
+        ivec2 along = edgeX ? ivec2(0, 1) : ivec2(1, 0);
+        ivec2 odd = along * (cell & 1);
+        height = 0.5 * (clipmapCell((cell - odd) / 2, level + 1).r + clipmapCell((cell + odd) / 2, level + 1).r);
+    }
+
+    // slope from the neighbouring cells, within the window
+    float spacing = levelSpacing(level);
+    ivec2 lo = max(grid - 1, ivec2(0)), hi = min(grid + 1, ivec2(CLIPMAP_CELLS));
+    float dx = clipmapCell(levelOrigin[level] + ivec2(hi.x, grid.y), level).r - clipmapCell(levelOrigin[level] + ivec2(lo.x, grid.y), level).r;
+    float dz = clipmapCell(levelOrigin[level] + ivec2(grid.x, hi.y), level).r - clipmapCell(levelOrigin[level] + ivec2(grid.x, lo.y), level).r;
+    vs_out.Normal = normalize(vec3(-dx / (float(hi.x - lo.x) * spacing), 1.0, -dz / (float(hi.y - lo.y) * spacing)));
+
+    vs_out.WorldPos = vec3(float(cell.x) * spacing, height, float(cell.y) * spacing);
+    vs_out.Layer = int(value.g);
+    vs_out.Level = level;
+    gl_Position = transformPosition(vs_out.WorldPos);
+}
@@ -0,0 +1,23 @@
+// clipmap windows shared by the horizon shaders: each level is a window of
+// CLIPMAP_CELLS x CLIPMAP_CELLS cells, twice the spacing of the level inside
+// it, stored toroidally in one layer of horizonHeights
+
+const int CLIPMAP_CELLS = 64;
+const int CLIPMAP_SIZE = CLIPMAP_CELLS + 1;
+
+uniform sampler2DArray horizonHeights;  // r: surface height, g: top texture layer, -1 if empty
+uniform ivec2 levelOrigin[8];           // first cell of each level's window
+uniform int levels;
+uniform float baseSpacing;              // blocks per cell in level 0
+
+float levelSpacing(int level)
+{
+    return baseSpacing * float(1 << level);
+}
+
+// height and top layer of a cell inside the window of level
+vec2 clipmapCell(ivec2 cell, int level)
+{
+    ivec2 texel = cell - CLIPMAP_SIZE * ivec2(floor(vec2(cell) / float(CLIPMAP_SIZE)));
+    return texelFetch(horizonHeights, ivec3(texel, level), 0).rg;
+}
@@ -0,0 +1,12 @@
+// distance fog shared by the block and terrain shaders: none up to
+// fogRange.x from the eye, rising to solid fogColor at fogRange.y, past which
+// nothing is drawn (the view distance, or the horizon's or world's edge)
+
+uniform vec3 fogColor;
+uniform vec2 fogRange;
+
+vec3 applyFog(vec3 color, float distance)
+{
+    float fog = clamp((distance - fogRange.x) / max(fogRange.y - fogRange.x, 0.0001), 0.0, 1.0);
+    return mix(color, fogColor, fog);
+}
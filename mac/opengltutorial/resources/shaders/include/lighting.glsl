@@ -0,0 +1,24 @@
+// lighting shared by the block shaders
+// define BLINN for Blinn-Phong highlights, otherwise plain Phong is used
+
+vec3 blockLighting(vec3 color, vec3 normal, vec3 fragPos, vec3 lightPos, vec3 viewPos)
+{
+    // ambient
+    vec3 ambient = 0.03 * color;
+    // diffuse
+    vec3 lightDir = normalize(lightPos - fragPos);
+    normal = normalize(normal);
+    float diff = max(dot(lightDir, normal), 0.0);
+    vec3 diffuse = diff * color;
+    // specular
+    vec3 viewDir = normalize(viewPos - fragPos);
+#ifdef BLINN
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), 32.0);
+#else
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 8.0);
+#endif
+    vec3 specular = vec3(0.3) * spec; // assuming bright white light color
+    return ambient + diffuse + specular;
+}
@@ -0,0 +1,16 @@
+// model/view/projection transform shared by the 3d vertex shaders
+
+uniform mat4 model;
+uniform mat4 projection;
+uniform mat4 view;
+
+vec4 transformPosition(vec3 position)
+{
+    return projection * view * model * vec4(position, 1.0f);
+}
+
+// position relative to the eye, in view space
+vec3 eyePosition(vec3 position)
+{
+    return (view * model * vec4(position, 1.0f)).xyz;
+}
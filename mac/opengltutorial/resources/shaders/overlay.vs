@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec4 aColor;
+
+out vec4 ourColor;
+
+// aPos.xy is in pixels from the top left corner; aPos.z is the NDC depth, near
+// the near plane so the overlay is drawn over the scene
+uniform vec2 screenSize;
+
+void main()
+{
+    vec2 ndc = aPos.xy / screenSize * 2.0 - 1.0;
+    gl_Position = vec4(ndc.x, -ndc.y, aPos.z, 1.0);
+    ourColor = aColor;
+}
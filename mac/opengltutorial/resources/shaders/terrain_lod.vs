@@ -0,0 +1,29 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+layout (location = 2) in vec3 aNormal;
+layout (location = 3) in float aLayer;
+layout (location = 4) in vec3 aLocal;
+
+// same outputs as 3d_lighting.vs, so the far terrain shares its fragment shader
+out VS_OUT {
+    vec3 FragPos;
+    vec3 Normal;
+    vec2 TexCoords;
+    flat int Layer;
+    float EyeDistance;
+} vs_out;
+
+#include "include/transform.glsl"
+
+void main()
+{
+    // blocks are lit in their own unit cube, so light each face of a cell
+    // as if it were the face of one block
+    vs_out.FragPos = aLocal;
+    vs_out.Normal = aNormal;
+    vs_out.TexCoords = aTexCoords;
+    vs_out.Layer = int(aLayer);
+    vs_out.EyeDistance = length(eyePosition(aPos));
+    gl_Position = transformPosition(aPos);
+}
@@ -0,0 +1,241 @@
+//
+//  bake_textures.cpp
+//  opengltutorial
+//
+//  Converts the block textures into one block-compressed texture array
+//  (see texture/TextureArray.h) so the game does no PNG decoding and each
+//  tile gets its own mip chain. Layers are written in BLOCK_TEXTURE_FILES
+//  order, which BlockTextureLayers in block/Block.h indexes into. Opaque
+//  layers use BC1; if any texel has alpha the whole array is BC3.
+//
+//  build: c++ -std=c++14 -O2 -I../files/include bake_textures.cpp -o bake_textures
+//  usage: bake_textures <textures dir> <output>
+//     e.g. bake_textures ../opengltutorial/resources/textures ../opengltutorial/resources/textures/blocks.texarray
+//
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image/stb_image.h"
+
+#include "texture/TextureArray.h"
+
+const char* BLOCK_TEXTURE_FILES[] = {
+    "grass/grass_top.png",
+    "grass/grass_side.png",
+    "grass/grass_bottom.png",
+    "water.png",
+    "sprite_4.png",
+    "sprite_5.png",
+    "sprite_6.png",
+    "sprite_7.png",
+    "sprite_8.png",
+};
+
+struct Image {
+    int width, height;
+    std::vector<unsigned char> rgba;
+};
+
+// 2x2 box filter
+Image downsample(const Image& src)
+{
+    Image dst;
+    dst.width = std::max(1, src.width / 2);
+    dst.height = std::max(1, src.height / 2);
+    dst.rgba.resize(dst.width * dst.height * 4);
+    for (int y = 0; y < dst.height; y++) {
+        for (int x = 0; x < dst.width; x++) {
+            for (int c = 0; c < 4; c++) {
+                int sum = 0;
+                for (int dy = 0; dy < 2; dy++) {
+                    for (int dx = 0; dx < 2; dx++) {
+                        int sx = std::min(src.width - 1, x * 2 + dx);
+                        int sy = std::min(src.height - 1, y * 2 + dy);
+                        sum += src.rgba[(sy * src.width + sx) * 4 + c];
+                    }
+                }
+                dst.rgba[(y * dst.width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+    return dst;
+}
+
+uint16_t toRGB565(const int* c)
+{
+    return (uint16_t)(((c[0] * 31 + 127) / 255) << 11 | ((c[1] * 63 + 127) / 255) << 5 | ((c[2] * 31 + 127) / 255));
+}
+
+void fromRGB565(uint16_t v, int* c)
+{
+    c[0] = ((v >> 11) & 31) * 255 / 31;
+    c[1] = ((v >> 5) & 63) * 255 / 63;
+    c[2] = (v & 31) * 255 / 31;
+}
+
+// BC1 color block: endpoints are the texels furthest apart along the
+// block's bounding-box diagonal, every texel takes the nearest of the four
+// palette entries
+void encodeColorBlock(const unsigned char block[16][4], std::vector<unsigned char>& out)
+{
+    int lo[3] = { 255, 255, 255 }, hi[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) {
+            lo[c] = std::min(lo[c], (int)block[i][c]);
+            hi[c] = std::max(hi[c], (int)block[i][c]);
+        }
+    }
+    int axis[3] = { hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2] };
+    int minDot = 1 << 30, maxDot = -(1 << 30), minI = 0, maxI = 0;
+    for (int i = 0; i < 16; i++) {
+        int d = block[i][0] * axis[0] + block[i][1] * axis[1] + block[i][2] * axis[2];
+        if (d < minDot) { minDot = d; minI = i; }
+        if (d > maxDot) { maxDot = d; maxI = i; }
+    }
+    int a[3] = { block[maxI][0], block[maxI][1], block[maxI][2] };
+    int b[3] = { block[minI][0], block[minI][1], block[minI][2] };
+    uint16_t c0 = toRGB565(a), c1 = toRGB565(b);
+    if (c0 < c1)
+        std::swap(c0, c1);
+
+    int palette[4][3];
+    fromRGB565(c0, palette[0]);
+    fromRGB565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestDist = 1 << 30;
+            for (int p = 0; p < 4; p++) {
+                int dist = 0;
+                for (int c = 0; c < 3; c++)
+                    dist += (block[i][c] - palette[p][c]) * (block[i][c] - palette[p][c]);
+                if (dist < bestDist) { bestDist = dist; best = p; }
+            }
+            indices |= (uint32_t)best << (i * 2);
+        }
+    }
+    out.push_back(c0 & 0xff);
+    out.push_back(c0 >> 8);
+    out.push_back(c1 & 0xff);
+    out.push_back(c1 >> 8);
+    for (int i = 0; i < 4; i++)
+        out.push_back((indices >> (i * 8)) & 0xff);
+}
+
+// BC3 alpha block in the 8-value mode
+void encodeAlphaBlock(const unsigned char block[16][4], std::vector<unsigned char>& out)
+{
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; i++) {
+        a0 = std::max(a0, (int)block[i][3]);
+        a1 = std::min(a1, (int)block[i][3]);
+    }
+    int palette[8] = { a0, a1 };
+    for (int i = 1; i < 7; i++)
+        palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+    uint64_t indices = 0;
+    if (a0 != a1) {
+        for (int i = 0; i < 16; i++) {
+            int best = 0;
+            for (int p = 1; p < 8; p++) {
+                if (abs(block[i][3] - palette[p]) < abs(block[i][3] - palette[best]))
+                    best = p;
+            }
+            indices |= (uint64_t)best << (i * 3);
+        }
+    }
+    out.push_back((unsigned char)a0);
+    out.push_back((unsigned char)a1);
+    for (int i = 0; i < 6; i++)
+        out.push_back((indices >> (i * 8)) & 0xff);
+}
+
+void compress(const Image& image, uint32_t format, std::vector<unsigned char>& out)
+{
+    for (int by = 0; by < image.height; by += 4) {
+        for (int bx = 0; bx < image.width; bx += 4) {
+            unsigned char block[16][4];
+            for (int i = 0; i < 16; i++) {
+                int x = std::min(image.width - 1, bx + i % 4);
+                int y = std::min(image.height - 1, by + i / 4);
+                for (int c = 0; c < 4; c++)
+                    block[i][c] = image.rgba[(y * image.width + x) * 4 + c];
+            }
+            if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+                encodeAlphaBlock(block, out);
+            encodeColorBlock(block, out);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3) {
+        std::cout << "usage: " << argv[0] << " <textures dir> <output>" << std::endl;
+        return 1;
+    }
+    std::string directory = argv[1];
+    std::vector<Image> layers;
+    bool alpha = false;
+    for (const char* name : BLOCK_TEXTURE_FILES) {
+        Image image;
+        int channels;
+        unsigned char* data = stbi_load((directory + "/" + name).c_str(), &image.width, &image.height, &channels, 4);
+        if (data == NULL) {
+            std::cout << "Texture failed to load at path: " << directory << "/" << name << std::endl;
+            return 1;
+        }
+        image.rgba.assign(data, data + image.width * image.height * 4);
+        stbi_image_free(data);
+        if (!layers.empty() && (image.width != layers[0].width || image.height != layers[0].height)) {
+            std::cout << "ERROR::BAKE::SIZE_MISMATCH " << name << std::endl;
+            return 1;
+        }
+        for (size_t i = 3; i < image.rgba.size(); i += 4)
+            alpha = alpha || image.rgba[i] != 255;
+        layers.push_back(image);
+    }
+
+    TextureArrayHeader header = {};
+    header.magic = TEXTURE_ARRAY_MAGIC;
+    header.version = TEXTURE_ARRAY_VERSION;
+    header.format = alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    header.width = layers[0].width;
+    header.height = layers[0].height;
+    header.layers = (uint32_t)layers.size();
+
+    std::vector<uint32_t> levelSizes;
+    std::vector<unsigned char> data;
+    while (true) {
+        size_t before = data.size();
+        for (const Image& layer : layers)
+            compress(layer, header.format, data);
+        levelSizes.push_back((uint32_t)(data.size() - before));
+        if (layers[0].width == 1 && layers[0].height == 1)
+            break;
+        for (Image& layer : layers)
+            layer = downsample(layer);
+    }
+    header.levels = (uint32_t)levelSizes.size();
+
+    std::ofstream out(argv[2], std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cout << "ERROR::BAKE::NOT_WRITTEN " << argv[2] << std::endl;
+        return 1;
+    }
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)levelSizes.data(), levelSizes.size() * sizeof(uint32_t));
+    out.write((const char*)data.data(), data.size());
+    std::cout << "baked " << header.layers << " layers, " << header.width << "x" << header.height << ", "
+              << header.levels << " levels, " << (alpha ? "BC3" : "BC1") << " (" << data.size() << " bytes)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,226 @@
+//
+//  microbench.cpp
+//  opengltutorial
+//
+//  Times the engine's per-frame CPU routines against worlds of 10^3 to 10^7
+//  blocks, without a window or GL context, to show how each one scales with
+//  the world. A kernel is a function run against a BenchWorld; add one with
+//  MICROBENCH(name, description) and it is picked up by the harness. Each
+//  kernel at each size is repeated until --min-time has passed and reported
+//  as time per call and per block.
+//
+//  build: c++ -std=c++14 -O2 -DLOG_MIN_LEVEL=LOG_LEVEL_WARNING -I../files/include microbench.cpp ../opengltutorial/Block.cpp ../glad.c -pthread -o microbench
+//  (the warning level keeps the routines' info logging out of the timings)
+//  usage: microbench [--sizes N,N,...] [--filter TEXT] [--min-time SECONDS] [--csv FILE]
+//     e.g. microbench --sizes 1000,100000 --filter updateLook
+//
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "block/Block.h"
+#include "camera/Camera.h"
+
+// A flat world of exactly Size blocks: a square floor at y = -1, the last
+// row partly filled, with the camera standing at its centre looking ahead
+// and down at the ground, as in the game.
+struct BenchWorld {
+    size_t Size;
+    std::vector<Block> Blocks;
+    Camera Player;
+
+    BenchWorld(size_t size) : Size(size), Player(&Blocks) {
+        Blocks.reserve(size);
+        long long side = (long long)std::ceil(std::sqrt((double)size));
+        long long half = side / 2;
+        for (long long z = -half; (size_t)Blocks.size() < size; z++) {
+            for (long long x = -half; x < side - half && Blocks.size() < size; x++)
+                Blocks.emplace_back(glm::vec3((float)x, -1.0f, (float)z), grass, true);
+        }
+        Reset();
+    }
+
+    // puts the camera back where each call starts
+    void Reset() {
+        Player.SetPose(glm::vec3(0.5f, 1.9f, 0.5f), -90.0f, -40.0f);
+        Player.YVelocity = 0;
+        Player.grounded = true;
+        Player.sprinting = false;
+    }
+};
+
+typedef void (*KernelFunction)(BenchWorld& world);
+
+struct Kernel {
+    const char* Name;
+    const char* Description;
+    KernelFunction Run;
+};
+
+std::vector<Kernel>& kernels()
+{
+    static std::vector<Kernel> all;
+    return all;
+}
+
+struct KernelRegistration {
+    KernelRegistration(const char* name, const char* description, KernelFunction run) {
+        kernels().push_back({ name, description, run });
+    }
+};
+
+#define MICROBENCH(name, description) \
+    static void name(BenchWorld& world); \
+    static KernelRegistration name##Registration(#name, description, name); \
+    static void name(BenchWorld& world)
+
+// keeps a result alive so the work producing it is not optimised away
+template <typename T>
+inline void keep(const T& value)
+{
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+MICROBENCH(handleGravity, "Camera::ProcessGravity, one frame standing on the floor")
+{
+    world.Player.ProcessGravity(1.0f / 60.0f);
+    keep(world.Player.Position);
+}
+
+MICROBENCH(collision, "Camera::ProcessKeyboard, one step forward with block collision")
+{
+    world.Player.ProcessKeyboard(FORWARD, 1.0f / 60.0f);
+    keep(world.Player.Position);
+    world.Reset();
+}
+
+MICROBENCH(updateLook, "Camera::updateLook, raycast to the block in view")
+{
+    world.Player.updateLook();
+    keep(world.Player.CurrentBlockIndex);
+}
+
+MICROBENCH(placeDuplicateCheck, "Camera::FindBlock as PlaceBlock uses it, for an empty cell")
+{
+    int index = world.Player.FindBlock(glm::vec3(0.0f, 5.0f, 0.0f));
+    keep(index);
+}
+
+MICROBENCH(destroyErase, "std::vector::erase as DestroyBlock uses it, from the middle")
+{
+    std::vector<Block>& blocks = world.Blocks;
+    size_t index = blocks.size() / 2;
+    Block removed = blocks[index];
+    blocks.erase(blocks.begin() + index);
+    // put it back at the end so the world stays the same size
+    blocks.push_back(removed);
+}
+
+MICROBENCH(modelMatrices, "the draw loop's per-block model matrix, for every block")
+{
+    float sum = 0.0f;
+    for (const Block& b : world.Blocks) {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, b.position);
+        keep(model);
+        sum += model[3][0];
+    }
+    keep(sum);
+}
+
+struct Result {
+    std::string Kernel;
+    size_t Size;
+    long long Calls;
+    double NanosPerCall;
+};
+
+std::vector<size_t> parseSizes(const char* list)
+{
+    std::vector<size_t> sizes;
+    for (const char* p = list; *p; ) {
+        char* end;
+        double size = strtod(p, &end);
+        if (end == p)
+            break;
+        sizes.push_back((size_t)size);
+        p = *end == ',' ? end + 1 : end;
+    }
+    return sizes;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<size_t> sizes = { 1000, 10000, 100000, 1000000, 10000000 };
+    std::string filter;
+    double minTime = 0.25;
+    std::string csvPath;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--sizes") == 0 && hasValue)
+            sizes = parseSizes(argv[++i]);
+        else if (strcmp(argv[i], "--filter") == 0 && hasValue)
+            filter = argv[++i];
+        else if (strcmp(argv[i], "--min-time") == 0 && hasValue)
+            minTime = atof(argv[++i]);
+        else if (strcmp(argv[i], "--csv") == 0 && hasValue)
+            csvPath = argv[++i];
+        else {
+            std::cout << "usage: " << argv[0] << " [--sizes N,N,...] [--filter TEXT] [--min-time SECONDS] [--csv FILE]" << std::endl;
+            for (const Kernel& k : kernels())
+                printf("  %-20s %s\n", k.Name, k.Description);
+            return -1;
+        }
+    }
+
+    std::vector<Result> results;
+    printf("%-20s %10s %10s %14s %12s\n", "kernel", "blocks", "calls", "ns/call", "ns/block");
+    for (size_t size : sizes) {
+        BenchWorld world(size);
+        for (const Kernel& k : kernels()) {
+            if (!filter.empty() && strstr(k.Name, filter.c_str()) == NULL)
+                continue;
+            world.Reset();
+            // one untimed call to warm the caches, then batches that double
+            // until the kernel has run for minTime
+            k.Run(world);
+            long long calls = 0;
+            long long batch = 1;
+            auto begin = std::chrono::steady_clock::now();
+            double elapsed = 0.0;
+            while (elapsed < minTime) {
+                for (long long i = 0; i < batch; i++)
+                    k.Run(world);
+                calls += batch;
+                batch *= 2;
+                elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            }
+            Result r = { k.Name, size, calls, elapsed * 1e9 / calls };
+            results.push_back(r);
+            printf("%-20s %10zu %10lld %14.1f %12.3f\n", k.Name, size, calls, r.NanosPerCall, r.NanosPerCall / size);
+            fflush(stdout);
+        }
+    }
+    if (!csvPath.empty()) {
+        FILE* f = fopen(csvPath.c_str(), "w");
+        if (f == NULL) {
+            std::cout << "ERROR::MICROBENCH::CSV_NOT_WRITTEN " << csvPath << std::endl;
+            return -1;
+        }
+        fprintf(f, "kernel,blocks,calls,ns_per_call\n");
+        for (const Result& r : results)
+            fprintf(f, "%s,%zu,%lld,%.1f\n", r.Kernel.c_str(), r.Size, r.Calls, r.NanosPerCall);
+        fclose(f);
+        std::cout << "wrote " << results.size() << " results to " << csvPath << std::endl;
+    }
+    return 0;
+}
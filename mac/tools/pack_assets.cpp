@@ -0,0 +1,103 @@
+//
+//  pack_assets.cpp
+//  opengltutorial
+//
+//  Bundles everything under a resources directory into one asset pack that
+//  the game maps at startup (see asset/AssetPack.h).
+//
+//  build: c++ -std=c++14 -O2 -I../files/include pack_assets.cpp -o pack_assets
+//  usage: pack_assets <resources dir> <output pack>
+//     e.g. pack_assets ../opengltutorial/resources assets.pack
+//
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "asset/AssetPack.h"
+
+struct PackFile {
+    std::string name;
+    std::string path;
+};
+
+// collect regular files below dir, named by their path relative to root
+void collectFiles(const std::string& dir, const std::string& prefix, std::vector<PackFile>& files)
+{
+    DIR* d = opendir(dir.c_str());
+    if (d == NULL)
+        return;
+    while (dirent* entry = readdir(d)) {
+        std::string name = entry->d_name;
+        if (name.empty() || name[0] == '.')
+            continue;
+        std::string path = dir + "/" + name;
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode))
+            collectFiles(path, prefix + name + "/", files);
+        else if (S_ISREG(st.st_mode))
+            files.push_back({ prefix + name, path });
+    }
+    closedir(d);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3) {
+        std::cout << "usage: " << argv[0] << " <resources dir> <output pack>" << std::endl;
+        return 1;
+    }
+    std::vector<PackFile> files;
+    collectFiles(argv[1], "", files);
+    std::sort(files.begin(), files.end(), [](const PackFile& a, const PackFile& b) {
+        return strncmp(a.name.c_str(), b.name.c_str(), PACK_NAME_LENGTH) < 0;
+    });
+
+    std::vector<PackEntry> entries(files.size());
+    std::vector<std::string> contents(files.size());
+    uint64_t offset = sizeof(PackHeader) + files.size() * sizeof(PackEntry);
+    for (size_t i = 0; i < files.size(); i++) {
+        if (files[i].name.size() >= PACK_NAME_LENGTH) {
+            std::cout << "ERROR::PACK::NAME_TOO_LONG " << files[i].name << std::endl;
+            return 1;
+        }
+        std::ifstream in(files[i].path, std::ios::binary);
+        std::stringstream stream;
+        stream << in.rdbuf();
+        contents[i] = stream.str();
+
+        offset = (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+        memset(&entries[i], 0, sizeof(PackEntry));
+        entries[i].offset = offset;
+        entries[i].size = contents[i].size();
+        strncpy(entries[i].name, files[i].name.c_str(), PACK_NAME_LENGTH - 1);
+        offset += contents[i].size();
+    }
+
+    std::ofstream out(argv[2], std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cout << "ERROR::PACK::NOT_WRITTEN " << argv[2] << std::endl;
+        return 1;
+    }
+    PackHeader header = { PACK_MAGIC, PACK_VERSION, (uint32_t)files.size(), 0 };
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)entries.data(), entries.size() * sizeof(PackEntry));
+    uint64_t written = sizeof(PackHeader) + entries.size() * sizeof(PackEntry);
+    for (size_t i = 0; i < files.size(); i++) {
+        static const char zeros[PACK_ALIGNMENT] = {};
+        out.write(zeros, entries[i].offset - written);
+        out.write(contents[i].data(), contents[i].size());
+        written = entries[i].offset + contents[i].size();
+        std::cout << entries[i].name << " (" << entries[i].size << " bytes)" << std::endl;
+    }
+    std::cout << "packed " << files.size() << " files into " << argv[2] << " (" << written << " bytes)" << std::endl;
+    return 0;
+}
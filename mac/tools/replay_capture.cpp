@@ -0,0 +1,604 @@
+//
+//  replay_capture.cpp
+//  opengltutorial
+//
+//  Replays frames recorded with the game's --capture option (see
+//  render/CaptureDevice.h) in an offscreen context, with no game logic, and
+//  times them. The capture is decoded once up front so only the GL calls
+//  themselves are timed; --null times the same calls against a NullDevice.
+//  Captures that upload buffers or textures get their starting contents back
+//  before each repeat, untimed. Programs load from the captured binary when
+//  the driver takes it and are compiled from their sources otherwise;
+//  --source always compiles.
+//
+//  build: c++ -std=c++14 -O2 -I../files/include replay_capture.cpp ../glad.c -lEGL -ldl -o replay_capture
+//  usage: replay_capture <capture> [--repeat N] [--png FILE] [--null] [--source]
+//     e.g. replay_capture spawn.ogcp --repeat 100 --png spawn.png
+//
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+
+#include "platform/HeadlessBackend.h"
+#include "render/GlDevice.h"
+#include "render/NullDevice.h"
+#include "render/CaptureDevice.h"
+
+typedef void (APIENTRYP ProgramBinaryFn)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+
+// one decoded command; ids are already translated to replay names, any
+// values live in the floats/ints arrays starting at data and uploaded
+// contents in bytes starting at bytes
+struct Command {
+    uint8_t op;
+    uint32_t a, b;
+    int32_t count;
+    uint64_t offset;
+    uint64_t size;
+    size_t data;
+    size_t bytes;
+};
+
+// bounds-checked reads from the capture
+struct Reader {
+    const unsigned char* at;
+    const unsigned char* end;
+
+    bool has(size_t bytes) const {
+        return (size_t)(end - at) >= bytes;
+    }
+
+    template <typename T>
+    T get() {
+        T value;
+        memcpy(&value, at, sizeof(T));
+        at += sizeof(T);
+        return value;
+    }
+};
+
+struct Replay {
+    std::vector<Command> commands;
+    std::vector<float> floats;
+    std::vector<int> ints;
+    std::vector<unsigned char> bytes;
+    std::map<uint32_t, unsigned int> programs, vertexArrays, buffers, textures;
+    // captured uniform location to replay location, by captured program
+    std::map<uint32_t, std::map<int, int>> uniforms;
+    // what uploaded buffers and textures start from, put back between repeats
+    std::vector<std::pair<unsigned int, Reader>> bufferContents, textureContents;
+    bool uploads = false;
+};
+
+// the replay name of a captured one; false if the capture holds no such
+// resource, so nothing is silently drawn with name 0 instead. 0 stays 0.
+bool lookup(const std::map<uint32_t, unsigned int>& names, uint32_t id, uint32_t& name)
+{
+    if (id == 0) {
+        name = 0;
+        return true;
+    }
+    auto it = names.find(id);
+    if (it == names.end()) {
+        std::cout << "ERROR::REPLAY::MISSING_RESOURCE " << id << std::endl;
+        return false;
+    }
+    name = it->second;
+    return true;
+}
+
+void applyState(const CaptureState& state)
+{
+    state.depthTest ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
+    state.blend ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
+    state.framebufferSrgb ? glEnable(GL_FRAMEBUFFER_SRGB) : glDisable(GL_FRAMEBUFFER_SRGB);
+    state.cullFace ? glEnable(GL_CULL_FACE) : glDisable(GL_CULL_FACE);
+    glBlendFunc(state.blendSrc, state.blendDst);
+    glDepthFunc(state.depthFunc);
+    glClearDepth(state.clearDepth);
+}
+
+GLenum textureBinding(GLenum target)
+{
+    return target == GL_TEXTURE_2D ? GL_TEXTURE_BINDING_2D : target == GL_TEXTURE_3D ? GL_TEXTURE_BINDING_3D : GL_TEXTURE_BINDING_2D_ARRAY;
+}
+
+// defines every level of texture, bound on the active unit
+bool fillTexture(unsigned int texture, Reader payload)
+{
+    if (!payload.has(sizeof(CaptureTexture)))
+        return false;
+    CaptureTexture info = payload.get<CaptureTexture>();
+    glBindTexture(info.target, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t level = 0; level < info.levels; level++) {
+        if (!payload.has(sizeof(CaptureLevel)))
+            return false;
+        CaptureLevel l = payload.get<CaptureLevel>();
+        if (!payload.has(l.bytes))
+            return false;
+        bool layered = info.target == GL_TEXTURE_2D_ARRAY || info.target == GL_TEXTURE_3D;
+        if (l.compressed && layered)
+            glCompressedTexImage3D(info.target, level, l.internalFormat, l.width, l.height, l.depth, 0, l.bytes, payload.at);
+        else if (l.compressed)
+            glCompressedTexImage2D(info.target, level, l.internalFormat, l.width, l.height, 0, l.bytes, payload.at);
+        else if (layered)
+            glTexImage3D(info.target, level, l.internalFormat, l.width, l.height, l.depth, 0, GL_RGBA, l.type, payload.at);
+        else
+            glTexImage2D(info.target, level, l.internalFormat, l.width, l.height, 0, GL_RGBA, l.type, payload.at);
+        payload.at += l.bytes;
+    }
+    if (info.levels > 0)
+        glTexParameteri(info.target, GL_TEXTURE_MAX_LEVEL, info.levels - 1);
+    glTexParameteri(info.target, GL_TEXTURE_MIN_FILTER, info.minFilter);
+    glTexParameteri(info.target, GL_TEXTURE_MAG_FILTER, info.magFilter);
+    glTexParameteri(info.target, GL_TEXTURE_WRAP_S, info.wrapS);
+    glTexParameteri(info.target, GL_TEXTURE_WRAP_T, info.wrapT);
+    return true;
+}
+
+bool createTexture(uint32_t id, Reader payload, Replay& replay)
+{
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    if (!fillTexture(texture, payload))
+        return false;
+    replay.textures[id] = texture;
+    replay.textureContents.push_back(std::make_pair(texture, payload));
+    return true;
+}
+
+// puts back what the capture started from, for the next repeat
+void restoreContents(const Replay& replay)
+{
+    for (const auto& buffer : replay.bufferContents) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.first);
+        glBufferData(GL_COPY_WRITE_BUFFER, buffer.second.end - buffer.second.at, buffer.second.at, GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    for (const auto& texture : replay.textureContents) {
+        Reader payload = texture.second;
+        GLenum target = payload.get<CaptureTexture>().target;
+        GLint previous = 0;
+        glGetIntegerv(textureBinding(target), &previous);
+        fillTexture(texture.first, texture.second);
+        glBindTexture(target, previous);
+    }
+}
+
+// the bindings that follow a CaptureProgram, by name
+bool readBindings(Reader& payload, uint32_t count, std::vector<std::pair<std::string, int>>& bindings)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        if (!payload.has(sizeof(CaptureBinding)))
+            return false;
+        CaptureBinding binding = payload.get<CaptureBinding>();
+        if (!payload.has(binding.nameBytes))
+            return false;
+        bindings.push_back(std::make_pair(std::string((const char*)payload.at, binding.nameBytes), binding.location));
+        payload.at += binding.nameBytes;
+    }
+    return true;
+}
+
+unsigned int compileShader(GLenum type, const unsigned char* code, uint32_t length)
+{
+    unsigned int shader = glCreateShader(type);
+    const char* text = (const char*)code;
+    GLint textLength = (GLint)length;
+    glShaderSource(shader, 1, &text, &textLength);
+    glCompileShader(shader);
+    return shader;
+}
+
+// from the binary when there is one the driver takes, otherwise from source
+// with the captured attribute and output locations
+bool createProgram(uint32_t id, Reader payload, ProgramBinaryFn programBinary, bool fromSource, Replay& replay)
+{
+    if (!payload.has(sizeof(CaptureProgram)))
+        return false;
+    CaptureProgram info = payload.get<CaptureProgram>();
+    if (!payload.has((size_t)info.binaryBytes + info.vertexBytes + info.fragmentBytes + info.geometryBytes))
+        return false;
+    const unsigned char* binary = payload.at;
+    const unsigned char* vertex = binary + info.binaryBytes;
+    const unsigned char* fragment = vertex + info.vertexBytes;
+    const unsigned char* geometry = fragment + info.fragmentBytes;
+    payload.at = geometry + info.geometryBytes;
+    std::vector<std::pair<std::string, int>> attributes, outputs, uniforms;
+    if (!readBindings(payload, info.attributes, attributes) || !readBindings(payload, info.outputs, outputs)
+        || !readBindings(payload, info.uniforms, uniforms))
+        return false;
+
+    unsigned int program = glCreateProgram();
+    GLint linked = 0;
+    if (!fromSource && info.binaryBytes > 0 && programBinary != nullptr) {
+        programBinary(program, info.binaryFormat, binary, (GLsizei)info.binaryBytes);
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            glDeleteProgram(program);
+            program = glCreateProgram();
+        }
+    }
+    if (!linked && info.vertexBytes > 0) {
+        unsigned int shaders[3] = {
+            compileShader(GL_VERTEX_SHADER, vertex, info.vertexBytes),
+            compileShader(GL_FRAGMENT_SHADER, fragment, info.fragmentBytes),
+            info.geometryBytes > 0 ? compileShader(GL_GEOMETRY_SHADER, geometry, info.geometryBytes) : 0,
+        };
+        for (unsigned int shader : shaders)
+            if (shader != 0)
+                glAttachShader(program, shader);
+        for (const auto& attribute : attributes)
+            glBindAttribLocation(program, attribute.second, attribute.first.c_str());
+        for (const auto& output : outputs)
+            glBindFragDataLocation(program, output.second, output.first.c_str());
+        glLinkProgram(program);
+        for (unsigned int shader : shaders)
+            if (shader != 0)
+                glDeleteShader(shader);
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    }
+    if (!linked) {
+        char log[1024] = "";
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        std::cout << "ERROR::REPLAY::PROGRAM_NOT_BUILT " << id << "\n" << log << std::endl;
+        return false;
+    }
+    replay.programs[id] = program;
+    std::map<int, int>& locations = replay.uniforms[id];
+    for (const auto& uniform : uniforms)
+        locations[uniform.second] = glGetUniformLocation(program, uniform.first.c_str());
+    return true;
+}
+
+// vertex arrays point at buffers, so they are made after every buffer exists
+bool createVertexArray(uint32_t id, Reader payload, Replay& replay)
+{
+    if (!payload.has(sizeof(uint32_t)))
+        return false;
+    uint32_t elementBuffer = payload.get<uint32_t>();
+    if (!lookup(replay.buffers, elementBuffer, elementBuffer))
+        return false;
+    unsigned int vao;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+    while (payload.has(sizeof(CaptureAttrib))) {
+        CaptureAttrib attrib = payload.get<CaptureAttrib>();
+        if (!lookup(replay.buffers, attrib.buffer, attrib.buffer))
+            return false;
+        glBindBuffer(GL_ARRAY_BUFFER, attrib.buffer);
+        if (attrib.integer)
+            glVertexAttribIPointer(attrib.index, attrib.size, attrib.type, attrib.stride, (void*)(size_t)attrib.offset);
+        else
+            glVertexAttribPointer(attrib.index, attrib.size, attrib.type, attrib.normalized, attrib.stride, (void*)(size_t)attrib.offset);
+        glEnableVertexAttribArray(attrib.index);
+    }
+    glBindVertexArray(0);
+    replay.vertexArrays[id] = vao;
+    return true;
+}
+
+bool loadResources(Reader& file, uint32_t count, ProgramBinaryFn programBinary, bool fromSource, Replay& replay)
+{
+    std::vector<std::pair<uint32_t, Reader>> vertexArrays;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!file.has(sizeof(CaptureResource)))
+            return false;
+        CaptureResource resource = file.get<CaptureResource>();
+        if (!file.has(resource.size))
+            return false;
+        Reader payload = { file.at, file.at + resource.size };
+        file.at += resource.size;
+
+        switch (resource.kind) {
+            case CAPTURE_STATE:
+                if (payload.has(sizeof(CaptureState)))
+                    applyState(payload.get<CaptureState>());
+                break;
+            case CAPTURE_PROGRAM:
+                if (!createProgram(resource.id, payload, programBinary, fromSource, replay))
+                    return false;
+                break;
+            case CAPTURE_BUFFER: {
+                unsigned int buffer;
+                glGenBuffers(1, &buffer);
+                glBindBuffer(GL_ARRAY_BUFFER, buffer);
+                glBufferData(GL_ARRAY_BUFFER, resource.size, payload.at, GL_STATIC_DRAW);
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+                replay.buffers[resource.id] = buffer;
+                replay.bufferContents.push_back(std::make_pair(buffer, payload));
+                break;
+            }
+            case CAPTURE_VERTEX_ARRAY:
+                vertexArrays.push_back(std::make_pair(resource.id, payload));
+                break;
+            case CAPTURE_TEXTURE:
+                if (!createTexture(resource.id, payload, replay))
+                    return false;
+                break;
+        }
+    }
+    for (const auto& vao : vertexArrays) {
+        if (!createVertexArray(vao.first, vao.second, replay))
+            return false;
+    }
+    return true;
+}
+
+bool decodeCommands(Reader file, Replay& replay)
+{
+    const std::map<int, int>* uniforms = nullptr;     // of the program in use
+    while (file.has(1)) {
+        Command c = {};
+        c.op = file.get<uint8_t>();
+        switch (c.op) {
+            case OP_CLEAR:
+                if (!file.has(4 * sizeof(float) + sizeof(uint32_t)))
+                    return false;
+                c.data = replay.floats.size();
+                for (int i = 0; i < 4; i++)
+                    replay.floats.push_back(file.get<float>());
+                c.a = file.get<uint32_t>();
+                break;
+            case OP_USE_PROGRAM:
+            case OP_BIND_VERTEX_ARRAY:
+                if (!file.has(sizeof(uint32_t)))
+                    return false;
+                c.a = file.get<uint32_t>();
+                if (c.op == OP_USE_PROGRAM)
+                    uniforms = c.a != 0 ? &replay.uniforms[c.a] : nullptr;
+                if (!lookup(c.op == OP_USE_PROGRAM ? replay.programs : replay.vertexArrays, c.a, c.a))
+                    return false;
+                break;
+            case OP_ACTIVE_TEXTURE:
+                if (!file.has(sizeof(uint32_t)))
+                    return false;
+                c.a = file.get<uint32_t>();
+                break;
+            case OP_BIND_TEXTURE:
+                if (!file.has(2 * sizeof(uint32_t)))
+                    return false;
+                c.a = file.get<uint32_t>();
+                if (!lookup(replay.textures, file.get<uint32_t>(), c.b))
+                    return false;
+                break;
+            case OP_UNIFORM_INTS:
+            case OP_UNIFORM_FLOATS:
+            case OP_UNIFORM_MATRIX: {
+                if (!file.has(sizeof(int32_t) + 1))
+                    return false;
+                c.count = file.get<int32_t>();      // location
+                c.a = file.get<uint8_t>();          // components or matrix size
+                if (uniforms != nullptr) {
+                    auto location = uniforms->find(c.count);
+                    c.count = location != uniforms->end() ? location->second : -1;
+                }
+                size_t values = c.op == OP_UNIFORM_MATRIX ? c.a * c.a : c.a;
+                if (!file.has(values * 4))
+                    return false;
+                if (c.op == OP_UNIFORM_INTS) {
+                    c.data = replay.ints.size();
+                    for (size_t i = 0; i < values; i++)
+                        replay.ints.push_back(file.get<int32_t>());
+                }
+                else {
+                    c.data = replay.floats.size();
+                    for (size_t i = 0; i < values; i++)
+                        replay.floats.push_back(file.get<float>());
+                }
+                break;
+            }
+            case OP_DRAW_ELEMENTS:
+                if (!file.has(3 * sizeof(uint32_t) + sizeof(uint64_t)))
+                    return false;
+                c.a = file.get<uint32_t>();
+                c.count = file.get<int32_t>();
+                c.b = file.get<uint32_t>();
+                c.offset = file.get<uint64_t>();
+                break;
+            case OP_DRAW_ARRAYS:
+                if (!file.has(3 * sizeof(uint32_t)))
+                    return false;
+                c.a = file.get<uint32_t>();
+                c.b = file.get<int32_t>();
+                c.count = file.get<int32_t>();
+                break;
+            case OP_BUFFER_DATA:
+            case OP_BUFFER_SUB_DATA:
+                if (!file.has(c.op == OP_BUFFER_DATA ? 2 * sizeof(uint32_t) + sizeof(uint64_t) + 1 : sizeof(uint32_t) + 2 * sizeof(uint64_t)))
+                    return false;
+                if (!lookup(replay.buffers, file.get<uint32_t>(), c.a))
+                    return false;
+                if (c.op == OP_BUFFER_DATA) {
+                    c.size = file.get<uint64_t>();
+                    c.b = file.get<uint32_t>();                 // usage
+                    c.count = file.get<uint8_t>();              // has data
+                }
+                else {
+                    c.offset = file.get<uint64_t>();
+                    c.size = file.get<uint64_t>();
+                    c.count = 1;
+                }
+                if (c.count && !file.has(c.size))
+                    return false;
+                c.bytes = replay.bytes.size();
+                if (c.count)
+                    replay.bytes.insert(replay.bytes.end(), file.at, file.at + c.size);
+                file.at += c.count ? c.size : 0;
+                replay.uploads = true;
+                break;
+            case OP_TEX_SUB_IMAGE: {
+                if (!file.has(sizeof(CaptureTexImage)))
+                    return false;
+                CaptureTexImage image = file.get<CaptureTexImage>();
+                if (!file.has(image.bytes))
+                    return false;
+                c.a = image.target;
+                if (!lookup(replay.textures, image.texture, c.b))
+                    return false;
+                c.data = replay.ints.size();
+                const int values[] = { image.level, image.x, image.y, image.z, image.width, image.height, image.depth,
+                                       (int)image.format, (int)image.type, image.alignment };
+                replay.ints.insert(replay.ints.end(), values, values + 10);
+                c.bytes = replay.bytes.size();
+                replay.bytes.insert(replay.bytes.end(), file.at, file.at + image.bytes);
+                file.at += image.bytes;
+                replay.uploads = true;
+                break;
+            }
+            case OP_FRAME_END:
+                break;
+            default:
+                std::cout << "ERROR::REPLAY::UNKNOWN_OP " << (int)c.op << std::endl;
+                return false;
+        }
+        replay.commands.push_back(c);
+    }
+    return true;
+}
+
+// runs commands up to and including the next FRAME_END
+size_t replayFrame(const Replay& replay, size_t at, Device& device)
+{
+    for (; at < replay.commands.size(); at++) {
+        const Command& c = replay.commands[at];
+        switch (c.op) {
+            case OP_CLEAR: {
+                const float* color = &replay.floats[c.data];
+                device.Clear(color[0], color[1], color[2], color[3], c.a);
+                break;
+            }
+            case OP_USE_PROGRAM: device.UseProgram(c.a); break;
+            case OP_BIND_VERTEX_ARRAY: device.BindVertexArray(c.a); break;
+            case OP_BIND_TEXTURE: device.BindTexture(c.a, c.b); break;
+            case OP_ACTIVE_TEXTURE: device.ActiveTexture(c.a); break;
+            case OP_UNIFORM_INTS: device.UniformInts(c.count, c.a, &replay.ints[c.data]); break;
+            case OP_UNIFORM_FLOATS: device.UniformFloats(c.count, c.a, &replay.floats[c.data]); break;
+            case OP_UNIFORM_MATRIX: device.UniformMatrix(c.count, c.a, &replay.floats[c.data]); break;
+            case OP_DRAW_ELEMENTS: device.DrawElements(c.a, c.count, c.b, c.offset); break;
+            case OP_DRAW_ARRAYS: device.DrawArrays(c.a, c.b, c.count); break;
+            // on a binding of their own, leaving the vertex arrays' alone
+            case OP_BUFFER_DATA:
+                glBindBuffer(GL_COPY_WRITE_BUFFER, c.a);
+                device.BufferData(GL_COPY_WRITE_BUFFER, c.size, c.count ? &replay.bytes[c.bytes] : nullptr, c.b);
+                break;
+            case OP_BUFFER_SUB_DATA:
+                glBindBuffer(GL_COPY_WRITE_BUFFER, c.a);
+                device.BufferSubData(GL_COPY_WRITE_BUFFER, c.offset, c.size, &replay.bytes[c.bytes]);
+                break;
+            case OP_TEX_SUB_IMAGE: {
+                const int* i = &replay.ints[c.data];
+                GLint previous = 0;
+                glGetIntegerv(textureBinding(c.a), &previous);
+                glBindTexture(c.a, c.b);
+                glPixelStorei(GL_UNPACK_ALIGNMENT, i[9]);
+                device.TexSubImage3D(c.a, i[0], i[1], i[2], i[3], i[4], i[5], i[6], i[7], i[8], &replay.bytes[c.bytes]);
+                glBindTexture(c.a, previous);
+                break;
+            }
+            case OP_FRAME_END: return at + 1;
+        }
+    }
+    return at;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::cout << "usage: " << argv[0] << " <capture> [--repeat N] [--png FILE] [--null] [--source]" << std::endl;
+        return 1;
+    }
+    int repeat = 10;
+    std::string pngPath;
+    bool null = false;
+    bool fromSource = false;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+            repeat = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--png") == 0 && i + 1 < argc)
+            pngPath = argv[++i];
+        else if (strcmp(argv[i], "--null") == 0)
+            null = true;
+        else if (strcmp(argv[i], "--source") == 0)
+            fromSource = true;
+    }
+
+    FILE* f = fopen(argv[1], "rb");
+    if (f == NULL) {
+        std::cout << "ERROR::REPLAY::FILE_NOT_SUCCESFULLY_READ " << argv[1] << std::endl;
+        return 1;
+    }
+    std::vector<unsigned char> data;
+    unsigned char chunk[1 << 16];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        data.insert(data.end(), chunk, chunk + read);
+    fclose(f);
+
+    Reader file = { data.data(), data.data() + data.size() };
+    if (!file.has(sizeof(CaptureHeader))) {
+        std::cout << "ERROR::REPLAY::NOT_A_CAPTURE " << argv[1] << std::endl;
+        return 1;
+    }
+    CaptureHeader header = file.get<CaptureHeader>();
+    if (header.magic != CAPTURE_MAGIC || header.version != CAPTURE_VERSION) {
+        std::cout << "ERROR::REPLAY::NOT_A_CAPTURE " << argv[1] << std::endl;
+        return 1;
+    }
+
+    HeadlessBackend backend(INT_MAX);
+    if (!backend.Init(header.width, header.height, "replay")) {
+        backend.Shutdown();
+        return 1;
+    }
+    Replay replay;
+    ProgramBinaryFn programBinary = (ProgramBinaryFn)backend.Loader()("glProgramBinary");
+    if (!loadResources(file, header.resources, programBinary, fromSource, replay) || !file.has(header.commandBytes)
+        || !decodeCommands({ file.at, file.at + header.commandBytes }, replay)) {
+        std::cout << "ERROR::REPLAY::CORRUPT_CAPTURE " << argv[1] << std::endl;
+        backend.Shutdown();
+        return 1;
+    }
+
+    NullDevice nullDevice;
+    Device& device = null ? (Device&)nullDevice : (Device&)GlDevice::Instance();
+    std::vector<double> times;
+    for (int r = 0; r < repeat; r++) {
+        if (r > 0 && replay.uploads)
+            restoreContents(replay);
+        size_t at = 0;
+        while (at < replay.commands.size()) {
+            double start = backend.Time();
+            at = replayFrame(replay, at, device);
+            backend.Present();
+            times.push_back((backend.Time() - start) * 1000.0);
+        }
+    }
+    if (!pngPath.empty())
+        backend.Capture(pngPath);
+
+    const DeviceCounters& c = device.Counters;
+    double frames = (double)times.size();
+    std::sort(times.begin(), times.end());
+    double total = 0.0;
+    for (double t : times)
+        total += t;
+    std::cout << header.frames << " frame(s) x " << repeat << ", " << header.width << "x" << header.height
+              << (null ? ", null device" : "") << std::endl;
+    std::cout << "per frame: " << c.DrawCalls / frames << " draws, " << c.Triangles / frames << " triangles, "
+              << c.UniformCalls / frames << " uniforms, " << c.StateChanges / frames << " binds" << std::endl;
+    std::cout << "ms: min " << times.front() << ", median " << times[times.size() / 2] << ", mean " << total / frames
+              << ", max " << times.back() << std::endl;
+
+    backend.Shutdown();
+    return 0;
+}